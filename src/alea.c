@@ -0,0 +1,55 @@
+/**
+ * \file alea.c
+ * \brief Contient le generateur aleatoire a compteur des voitures.
+ *
+ * Chaque voiture possede son propre flux, derive de la graine globale et de son numero.
+ * Le n-ieme tirage d'un flux ne depend que de (graine, numero, n) : il ne depend ni de l'ordre d'execution des voitures, ni du nombre de processus ou de threads.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "project.h"
+#include "alea.h"
+
+unsigned long long graine_globale = 1;
+
+/**
+ * \fn unsigned long long melange(unsigned long long x)
+ * \brief Fonction de melange de splitmix64 : bijection de 64 bits vers 64 bits aux sorties uniformement reparties.
+ *
+ * \param x La valeur a melanger.
+ *
+ * \return La valeur melangee.
+ */
+unsigned long long melange(unsigned long long x)
+{
+	x += 0x9E3779B97F4A7C15ULL;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	return x ^ (x >> 31);
+}
+
+/**
+ * \fn void initialise_alea(Alea *a, int numero)
+ * \brief Initialise le flux aleatoire d'une voiture a partir de la graine globale.
+ *
+ * \param a Pointeur sur le flux a initialiser.
+ * \param numero Le numero de la voiture.
+ */
+void initialise_alea(Alea *a, int numero)
+{
+	a->cle = melange(graine_globale ^ melange((unsigned long long) numero));
+	a->compteur = 0;
+}
+
+/**
+ * \fn unsigned int alea(Alea *a)
+ * \brief Retourne le prochain nombre aleatoire (32 bits) du flux.
+ *
+ * \param a Pointeur sur le flux de la voiture.
+ *
+ * \return Le nombre aleatoire.
+ */
+unsigned int alea(Alea *a)
+{
+	return melange(a->cle + a->compteur++ * 0xD1B54A32D192ED03ULL) >> 32;
+}
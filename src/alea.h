@@ -0,0 +1,12 @@
+#ifndef __ALEA__
+#define __ALEA__
+
+#include "project.h"
+
+unsigned long long melange(unsigned long long x);
+
+void initialise_alea(Alea *a, int numero);
+
+unsigned int alea(Alea *a);
+
+#endif
@@ -0,0 +1,201 @@
+/**
+ * \file anneau.c
+ * \brief Contient le transport par anneaux en memoire partagee (option "-r") : aucun appel systeme tant que les destinataires sont occupes.
+ *
+ * Chaque file (serveur et carrefours) est un anneau borne a plusieurs producteurs et un seul consommateur : un producteur reserve sa case par compare-and-swap, puis la publie par son numero de sequence.
+ * Chaque voiture possede une boite de reponse, car elle n'attend qu'une reponse a la fois.
+ * Un consommateur ne s'endort (futex) que lorsque son anneau ou sa boite est vide ; le producteur ne le reveille que s'il s'est endormi.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/types.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <linux/futex.h>
+#include "project.h"
+#include "main.h"
+#include "transport.h"
+
+/*! Le segment de memoire partagee des anneaux et des boites. */
+int segment_anneaux = -1;
+/*! Les anneaux de requetes (anneaux[file]), attaches une seule fois avant les fork. */
+Anneau *anneaux = NULL;
+/*! Les boites de reponse (boites[client]), a la suite des anneaux. */
+Boite *boites = NULL;
+
+int envoie_requete_anneaux(int file, Message *m, int bloquant);
+
+int recoit_requete_anneaux(int file, Message *m, long long attente);
+
+int depose_reponse_anneaux(int file, int client, Reponse *rep, int bloquant);
+
+void attend_reponse_anneaux(int file, int client, Reponse *rep);
+
+Transport transport_anneaux = {"anneaux", envoie_requete_anneaux, recoit_requete_anneaux, depose_reponse_anneaux, attend_reponse_anneaux};
+
+/**
+ * \fn void initialise_anneaux(int nbFiles, int nbClients)
+ * \brief Cree et attache le segment des anneaux et des boites de reponse.
+ *
+ * \param nbFiles Le nombre d'anneaux (le serveur et les carrefours).
+ * \param nbClients Le nombre de boites de reponse (les voitures).
+ */
+void initialise_anneaux(int nbFiles, int nbClients)
+{
+	int i, j;
+
+	segment_anneaux = shmget(IPC_PRIVATE, nbFiles * sizeof(Anneau) + nbClients * sizeof(Boite), IPC_CREAT | 0600);
+	if (segment_anneaux == -1)
+		erreurFin("Pb shmget anneaux");
+	anneaux = shmat(segment_anneaux, NULL, 0);
+	if (anneaux == (void *) -1)
+		erreurFin("Pb shmat anneaux");
+	boites = (Boite *) (anneaux + nbFiles);
+
+	for (i=0;i<nbFiles;i++)
+		for (j=0;j<CAPACITE_ANNEAU;j++)
+			anneaux[i].cases[j].sequence = j;
+}
+
+/**
+ * \fn void supprime_anneaux()
+ * \brief Detache et supprime le segment des anneaux.
+ */
+void supprime_anneaux()
+{
+	if (segment_anneaux == -1)
+		return;
+
+	shmdt(anneaux);
+	shmctl(segment_anneaux, IPC_RMID, NULL);
+	segment_anneaux = -1;
+}
+
+/**
+ * \fn void futex(int *adresse, int operation, int valeur, long long attente)
+ * \brief Appelle futex(2) sur un mot partage entre processus (FUTEX_WAIT : dort si le mot vaut valeur, au plus attente microsecondes ; FUTEX_WAKE : reveille valeur processus).
+ */
+void futex(int *adresse, int operation, int valeur, long long attente)
+{
+	struct timespec duree;
+
+	duree.tv_sec = attente / 1000000;
+	duree.tv_nsec = (attente % 1000000) * 1000;
+	syscall(SYS_futex, adresse, operation, valeur, attente == ATTENTE_INFINIE ? NULL : &duree, NULL, 0);
+}
+
+/**
+ * \fn int envoie_requete_anneaux(int file, Message *m, int bloquant)
+ * \brief Depose une requete dans un anneau, et reveille son consommateur s'il attend.
+ *
+ * Si l'anneau est plein, le producteur reessaie apres MINPAUSE si bloquant vaut 1, et abandonne sinon.
+ */
+int envoie_requete_anneaux(int file, Message *m, int bloquant)
+{
+	Anneau *a = &anneaux[file];
+	CaseAnneau *c;
+	unsigned long long position, sequence;
+
+	position = __atomic_load_n(&a->ecriture, __ATOMIC_RELAXED);
+	while (1) {
+		c = &a->cases[position % CAPACITE_ANNEAU];
+		sequence = __atomic_load_n(&c->sequence, __ATOMIC_ACQUIRE);
+		if (sequence == position) {
+			if (__atomic_compare_exchange_n(&a->ecriture, &position, position + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		} else if ((long long) (sequence - position) < 0) {
+			if (!bloquant)
+				return -1;
+			usleep(MINPAUSE);
+			position = __atomic_load_n(&a->ecriture, __ATOMIC_RELAXED);
+		} else {
+			position = __atomic_load_n(&a->ecriture, __ATOMIC_RELAXED);
+		}
+	}
+
+	c->m = *m;
+	__atomic_store_n(&c->sequence, position + 1, __ATOMIC_RELEASE);
+
+	/* La publication doit etre visible avant la lecture de l'attente (sinon le consommateur pourrait s'endormir sur une requete deja publiee). */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&a->attente, __ATOMIC_RELAXED) == 1 && __atomic_exchange_n(&a->attente, 0, __ATOMIC_SEQ_CST) == 1)
+		futex(&a->attente, FUTEX_WAKE, 1, ATTENTE_INFINIE);
+	return 0;
+}
+
+/**
+ * \fn int retire_requete(Anneau *a, Message *m)
+ * \brief Retire la requete suivante d'un anneau, sans attendre (consommateur unique).
+ *
+ * \return 0 si une requete a ete lue, -1 si l'anneau est vide.
+ */
+int retire_requete(Anneau *a, Message *m)
+{
+	CaseAnneau *c = &a->cases[a->lecture % CAPACITE_ANNEAU];
+
+	if (__atomic_load_n(&c->sequence, __ATOMIC_ACQUIRE) != a->lecture + 1)
+		return -1;
+
+	*m = c->m;
+	__atomic_store_n(&c->sequence, a->lecture + CAPACITE_ANNEAU, __ATOMIC_RELEASE);
+	a->lecture++;
+	return 0;
+}
+
+/**
+ * \fn int recoit_requete_anneaux(int file, Message *m, long long attente)
+ * \brief Retire la requete suivante d'un anneau, en s'endormant au plus attente microsecondes sur l'anneau vide.
+ */
+int recoit_requete_anneaux(int file, Message *m, long long attente)
+{
+	Anneau *a = &anneaux[file];
+
+	if (retire_requete(a, m) == 0)
+		return 0;
+	if (attente == 0)
+		return -1;
+
+	__atomic_store_n(&a->attente, 1, __ATOMIC_SEQ_CST);
+	if (retire_requete(a, m) == 0) {
+		__atomic_store_n(&a->attente, 0, __ATOMIC_RELAXED);
+		return 0;
+	}
+	futex(&a->attente, FUTEX_WAIT, 1, attente);
+	__atomic_store_n(&a->attente, 0, __ATOMIC_RELAXED);
+	return retire_requete(a, m);
+}
+
+/**
+ * \fn int depose_reponse_anneaux(int file, int client, Reponse *rep, int bloquant)
+ * \brief Depose une reponse dans la boite d'un client et le reveille s'il attend (n'echoue jamais : un client attend au plus une reponse).
+ */
+int depose_reponse_anneaux(int file, int client, Reponse *rep, int bloquant)
+{
+	Boite *b = &boites[client];
+
+	b->rep = *rep;
+	if (__atomic_exchange_n(&b->etat, BOITE_PLEINE, __ATOMIC_RELEASE) == BOITE_ATTENTE)
+		futex(&b->etat, FUTEX_WAKE, 1, ATTENTE_INFINIE);
+	return 0;
+}
+
+/**
+ * \fn void attend_reponse_anneaux(int file, int client, Reponse *rep)
+ * \brief Attend la reponse dans la boite d'un client, en s'endormant sur la boite vide.
+ */
+void attend_reponse_anneaux(int file, int client, Reponse *rep)
+{
+	Boite *b = &boites[client];
+	int etat = BOITE_VIDE;
+
+	while ((etat = __atomic_load_n(&b->etat, __ATOMIC_ACQUIRE)) != BOITE_PLEINE) {
+		if (etat == BOITE_ATTENTE || __atomic_compare_exchange_n(&b->etat, &etat, BOITE_ATTENTE, 0, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+			futex(&b->etat, FUTEX_WAIT, BOITE_ATTENTE, ATTENTE_INFINIE);
+	}
+
+	*rep = b->rep;
+	__atomic_store_n(&b->etat, BOITE_VIDE, __ATOMIC_RELAXED);
+}
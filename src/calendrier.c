@@ -0,0 +1,131 @@
+/**
+ * \file calendrier.c
+ * \brief Contient la file de priorite des etapes programmees des voitures (remplace les pauses par usleep()).
+ *
+ * Les evenements sont ordonnes par date puis par ordre de programmation, ce qui rend l'ordre de traitement deterministe.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "project.h"
+#include "main.h"
+#include "calendrier.h"
+
+/**
+ * \fn int avant(Evenement *a, Evenement *b)
+ * \brief Indique si l'evenement a doit etre traite avant l'evenement b.
+ *
+ * \param a Pointeur sur le premier evenement.
+ * \param b Pointeur sur le second evenement.
+ *
+ * \return 1 si a precede b, 0 sinon.
+ */
+int avant(Evenement *a, Evenement *b)
+{
+	if (a->date != b->date)
+		return a->date < b->date;
+	return a->sequence < b->sequence;
+}
+
+/**
+ * \fn void initialise_calendrier(Calendrier *cal, int capacite)
+ * \brief Initialise un calendrier vide.
+ *
+ * \param cal Pointeur sur le calendrier a initialiser.
+ * \param capacite La capacite initiale (le calendrier s'agrandit si necessaire).
+ */
+void initialise_calendrier(Calendrier *cal, int capacite)
+{
+	if (capacite < 16)
+		capacite = 16;
+	cal->tas = malloc(capacite * sizeof(Evenement));
+	if (cal->tas == NULL)
+		erreurFin("Pb malloc calendrier");
+	cal->taille = 0;
+	cal->capacite = capacite;
+	cal->sequence = 0;
+}
+
+/**
+ * \fn void detruit_calendrier(Calendrier *cal)
+ * \brief Libere la memoire du calendrier.
+ *
+ * \param cal Pointeur sur le calendrier.
+ */
+void detruit_calendrier(Calendrier *cal)
+{
+	free(cal->tas);
+	cal->tas = NULL;
+	cal->taille = cal->capacite = 0;
+}
+
+/**
+ * \fn void programme(Calendrier *cal, long long date, EtatVoiture *e)
+ * \brief Programme la prochaine etape d'une voiture a une date donnee.
+ *
+ * \param cal Pointeur sur le calendrier.
+ * \param date La date de l'etape (en microseconde).
+ * \param e Pointeur sur la voiture concernee.
+ */
+void programme(Calendrier *cal, long long date, EtatVoiture *e)
+{
+	Evenement ev, tmp;
+	int i, parent;
+
+	if (cal->taille == cal->capacite) {
+		cal->capacite *= 2;
+		cal->tas = realloc(cal->tas, cal->capacite * sizeof(Evenement));
+		if (cal->tas == NULL)
+			erreurFin("Pb realloc calendrier");
+	}
+
+	ev.date = date;
+	ev.sequence = cal->sequence++;
+	ev.e = e;
+
+	i = cal->taille++;
+	cal->tas[i] = ev;
+	while (i > 0) {
+		parent = (i-1)/2;
+		if (!avant(&cal->tas[i], &cal->tas[parent]))
+			break;
+		tmp = cal->tas[i];
+		cal->tas[i] = cal->tas[parent];
+		cal->tas[parent] = tmp;
+		i = parent;
+	}
+}
+
+/**
+ * \fn int prochain(Calendrier *cal, Evenement *ev)
+ * \brief Retire l'evenement le plus proche du calendrier.
+ *
+ * \param cal Pointeur sur le calendrier.
+ * \param ev Pointeur sur l'evenement qui va etre renseigne.
+ *
+ * \return 1 si un evenement a ete retire, 0 si le calendrier est vide.
+ */
+int prochain(Calendrier *cal, Evenement *ev)
+{
+	Evenement tmp;
+	int i, fils;
+
+	if (cal->taille == 0)
+		return 0;
+
+	*ev = cal->tas[0];
+	cal->tas[0] = cal->tas[--cal->taille];
+
+	i = 0;
+	while ((fils = 2*i+1) < cal->taille) {
+		if (fils+1 < cal->taille && avant(&cal->tas[fils+1], &cal->tas[fils]))
+			fils++;
+		if (!avant(&cal->tas[fils], &cal->tas[i]))
+			break;
+		tmp = cal->tas[i];
+		cal->tas[i] = cal->tas[fils];
+		cal->tas[fils] = tmp;
+		i = fils;
+	}
+
+	return 1;
+}
@@ -0,0 +1,35 @@
+#ifndef __CALENDRIER__
+#define __CALENDRIER__
+
+#include "project.h"
+
+/**
+ * \struct Evenement
+ * \brief Represente la prochaine etape programmee d'une voiture.
+ */
+typedef struct Evenement {
+	long long date;	/*!< La date de l'etape (en microseconde). */
+	unsigned long sequence;	/*!< Le numero d'ordre de programmation, departage les evenements simultanes. */
+	EtatVoiture *e;	/*!< La voiture concernee. */
+} Evenement;
+
+/**
+ * \struct Calendrier
+ * \brief Represente une file de priorite d'evenements ordonnes par date (tas binaire).
+ */
+typedef struct Calendrier {
+	Evenement *tas;	/*!< Le tas binaire des evenements. */
+	int taille;	/*!< Le nombre d'evenements programmes. */
+	int capacite;	/*!< La capacite allouee du tas. */
+	unsigned long sequence;	/*!< Le prochain numero d'ordre. */
+} Calendrier;
+
+void initialise_calendrier(Calendrier *cal, int capacite);
+
+void detruit_calendrier(Calendrier *cal);
+
+void programme(Calendrier *cal, long long date, EtatVoiture *e);
+
+int prochain(Calendrier *cal, Evenement *ev);
+
+#endif
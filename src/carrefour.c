@@ -9,68 +9,613 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include <sys/ipc.h>
 #include <sys/shm.h>
+#include <sys/msg.h>
 #include <sys/types.h>
 #include "project.h"
+#include "sem.h"
+#include "serveur.h"
+#include "trace.h"
+#include "mesure.h"
+#include "statistiques.h"
+#include "message.h"
+#include "transport.h"
+#include "moteur.h"
+#include "voiture.h"
+#include "interblocage.h"
+#include "feux.h"
 #include "carrefour.h"
 
 /*! Represente la taille du carrefour. La valeur indique le nombre maximal de sections critiques par ligne/colonne (le carrefour est suppose carre et toutes les voies sont identiques). */
 #define TAILLE 5
 
+/*! Les files d'attente des requetes refusees, 1 par croisement (tete de file). Propres a chaque processus carrefour. */
+Attente *attentes_tete[25];
+/*! Les files d'attente des requetes refusees, 1 par croisement (queue de file). */
+Attente *attentes_queue[25];
+/*! Les reponses programmees ou qui n'ont pas pu etre deposees dans la file pleine, dans l'ordre (tete de file). */
+Differee *differees_tete = NULL;
+/*! Les reponses programmees ou qui n'ont pas pu etre deposees dans la file pleine (queue de file). */
+Differee *differees_queue = NULL;
+
+/*! Les compteurs des voies qui croisent chaque voie (voie v : indice v-1), dans l'occupation d'un carrefour (voir initialise_parcours()). */
+unsigned long long compteurs_conflit[12];
+/*! Les indicateurs d'attente des voies qui croisent chaque voie (voie v : indice v-1). */
+unsigned long long attentes_conflit[12];
+
+/*! Les reservations de parcours refusees, dans l'ordre d'arrivee (tete de file). Propres a chaque processus carrefour. */
+Attente *reservations_tete = NULL;
+/*! Les reservations de parcours refusees (queue de file). */
+Attente *reservations_queue = NULL;
+
+/*! Les demandes soumises au serveur dont la decision n'est pas encore revenue, 1 au plus par croisement (table des demandes en cours). */
+Requete en_cours[25];
+/*! L'origine de chaque demande en cours : AUCUNE_DEMANDE, DEMANDE_RECUE ou DEMANDE_REPRISE. */
+int origine_en_cours[25];
+
 /**
  * \fn void carrefour(int numero, pid_t pid_Serveur)
- * \brief Fonction realisee par chaque carrefour.
+ * \brief Fonction realisee par chaque carrefour : une boucle d'evenements.
+ *
+ * La file du carrefour porte tous ses evenements : les requetes des voitures et les decisions du serveur (MESSDECISION).
+ * Le carrefour ne bloque jamais en attendant le serveur : une demande lui est soumise (soumet()) et le carrefour traite d'autres evenements jusqu'au retour de sa decision (decision_recue()).
+ * Plusieurs demandes peuvent ainsi etre en cours, au plus une par croisement (deux demandes sur le meme croisement seraient decidees sur le meme etat) ; une demande sur un croisement deja en cours attend dans la file d'attente du croisement.
  *
- * Comprend 2 phases :
- * - Se connecte a la file de message correspondant au carrefour (1 seule parmis les 4).
- * - Receptionne sans arret les requetes des voitures dans sa file de message (1 par carrefour), les transmet au serveur si necessaire et retourne les reponses de ce dernier dans sa file le cas echeant.
+ * Une demande refusee n'est pas renvoyee a la voiture : elle est mise en attente sur le croisement demande (met_en_attente()), et la voiture reste bloquee sur sa reception sans emettre de message.
+ * Chaque mise a jour du carrefour reveille ensuite, dans l'ordre d'arrivee, les demandes en attente sur les croisements liberes (reveille_attentes()).
+ * Les autorisations sont envoyees MINPAUSE apres la decision (temps de traitement du carrefour) sans bloquer la boucle : elles sont programmees (envoie_reponse()), et l'attente d'evenement est limitee a la prochaine echeance.
  *
- * \param numero Le numero du carrefour (1<=numero<=4).
+ * En ordre par tickets (option "-f"), une demande qui arrive alors qu'une demande plus ancienne attend la meme case du croisement est mise en attente derriere elle sans etre decidee (voir case_en_attente()).
+ *
+ * Avec les feux (option "-c"), le carrefour fait avancer son feu a chaque evenement, et au plus tard toutes les MINPAUSE tant que des demandes attendent : un changement de phase reveille d'un coup les voitures arretees de la nouvelle phase verte.
+ *
+ * Les reservations de parcours (MESSRESERVE) sont decidees par le carrefour lui meme, quel que soit le mode d'admission : la verification porte sur un seul mot du segment (voir reserve_parcours()).
+ *
+ * \param numero Le numero du carrefour (1<=numero<=nb_carrefours).
  * \param pid_Serveur Le pid du processus serveur. Utile pour adresser les requetes au serveur, dans la file de message du serveur.
  */
 void carrefour(int numero, pid_t pid_Serveur)
 {
-	Requete req, req_serveur;
-	Reponse rep;
+	Requete req;
+	Message m;
+	long long attente;
+	unsigned long long feu = 0;
 
-	Carrefour *c;
-	
-	c = shmat(carrefours[numero-1], NULL, 0);
+	Carrefour *c = &reseau[numero-1];
 	
 	while (1) {
-		msgrcv(msg_carrefour[numero-1],&req,tailleReq,0,0);
-		if (req.type == MESSSORT) {
+		envoie_differees(numero);
+
+		if (feux == 1) {
+			avance_feu(c, maintenant());
+			if (__atomic_load_n(&c->feu, __ATOMIC_ACQUIRE) != feu) {
+				feu = __atomic_load_n(&c->feu, __ATOMIC_ACQUIRE);
+				reveille_attentes(NULL, c, numero, pid_Serveur);
+			}
+		}
+
+		attente = ATTENTE_INFINIE;
+		if (differees_tete != NULL) {
+			attente = differees_tete->date - maintenant();
+			if (attente <= 0)
+				attente = MINPAUSE;
+		}
+		if (feux == 1 && attente > MINPAUSE && demandes_en_attente() == 1)
+			attente = MINPAUSE;
+
+		if (transport->recoit_requete(numero, &m, attente) == -1 || decode_requete(&m, &req) == -1)
+			continue;
+
+		if (m.type == MESSDECISION) {
+			decision_recue(&req, autorisation_decision(&m), c, numero, pid_Serveur);
+		} else if (req.type == MESSSORT && reservation == 1) {
+			libere_parcours(c, req.voie);
+			reveille_reservations(c, numero);
+		} else if (req.type == MESSSORT) {
 			maj_carrefour(&req, c);
+			reveille_attentes(&req, c, numero, pid_Serveur);
+		} else if (req.type == MESSRESERVE) {
+			demande_parcours(&req, c, numero);
+		} else if (req.type == MESSDEMANDE) {
+			if (ordre == ORDRE_TICKETS && case_en_attente(&req) == 1) {
+				refuse(&req);
+			} else if (admission == ADMISSION_LOCALE) {
+				if (decision(c, &req) == 1)
+					accorde(&req, c, numero, pid_Serveur, MINPAUSE);
+				else
+					refuse(&req);
+			} else if (origine_en_cours[req.croisement] != AUCUNE_DEMANDE) {
+				met_en_attente(&req);
+			} else {
+				soumet(&req, DEMANDE_RECUE, pid_Serveur);
+			}
 		}
+	}
+}
+
+/**
+ * \fn void soumet(Requete *req, int origine, pid_t pid_Serveur)
+ * \brief Soumet une demande de voiture au serveur sans attendre sa decision, et l'inscrit dans la table des demandes en cours.
+ *
+ * \param req Pointeur sur la requete de la voiture.
+ * \param origine DEMANDE_RECUE (demande qui vient d'arriver) ou DEMANDE_REPRISE (demande reprise d'une file d'attente).
+ * \param pid_Serveur Le pid du processus serveur.
+ */
+void soumet(Requete *req, int origine, pid_t pid_Serveur)
+{
+	Requete req_serveur;
+	Message m;
+
+	en_cours[req->croisement] = *req;
+	origine_en_cours[req->croisement] = origine;
+
+	req_serveur = *req;
+	req_serveur.pidEmetteur = getpid();
+	encode_requete(&req_serveur, &m);
+	m.type = pid_Serveur;
+	transport->envoie_requete(FILE_SERVEUR, &m, 1);
+	compte_message();
+}
+
+/**
+ * \fn void decision_recue(Requete *decidee, int autorisation, Carrefour *c, int numero, pid_t pid_Serveur)
+ * \brief Applique la decision du serveur sur la demande en cours d'un croisement.
+ *
+ * Une demande autorisee est appliquee au carrefour (accorde()). Une demande refusee est mise en attente : en fin de file si elle venait d'arriver, en tete si elle avait ete reprise de la file.
+ * En ordre par tickets, une demande qui venait d'arriver est aussi remise en tete : les demandes arrivees pendant sa decision sur la meme case sont plus recentes.
+ * Le croisement n'ayant plus de demande en cours, ses demandes en attente sont ensuite examinees.
+ *
+ * \param decidee Pointeur sur la demande decidee, telle que renvoyee par le serveur.
+ * \param autorisation La decision du serveur.
+ * \param c Pointeur sur le carrefour.
+ * \param numero Le numero du carrefour.
+ * \param pid_Serveur Le pid du processus serveur.
+ */
+void decision_recue(Requete *decidee, int autorisation, Carrefour *c, int numero, pid_t pid_Serveur)
+{
+	int i = decidee->croisement;
+	int origine = origine_en_cours[i];
+	Requete req = en_cours[i];
+
+	origine_en_cours[i] = AUCUNE_DEMANDE;
+
+	if (autorisation == 1) {
+		accorde(&req, c, numero, pid_Serveur, origine == DEMANDE_RECUE ? MINPAUSE : 0);
+		return;
+	}
+
+	if (origine == DEMANDE_RECUE && ordre == ORDRE_TICKETS) {
+		trace_requete(&req, 0);
+		stats_refus(&req);
+		remet_en_attente(&req);
+	} else if (origine == DEMANDE_RECUE) {
+		refuse(&req);
+	} else {
+		remet_en_attente(&req);
+	}
+	reveille_attentes(&req, c, numero, pid_Serveur);
+}
+
+/**
+ * \fn void accorde(Requete *req, Carrefour *c, int numero, pid_t pid_Serveur, long long delai)
+ * \brief Applique une demande autorisee au carrefour, programme l'autorisation de la voiture et reveille les demandes en attente sur les croisements touches.
+ *
+ * \param req Pointeur sur la demande autorisee.
+ * \param c Pointeur sur le carrefour.
+ * \param numero Le numero du carrefour.
+ * \param pid_Serveur Le pid du processus serveur.
+ * \param delai Le delai avant l'envoi de l'autorisation (en microseconde).
+ */
+void accorde(Requete *req, Carrefour *c, int numero, pid_t pid_Serveur, long long delai)
+{
+	maj_carrefour(req, c);
+	autorise(req, numero, delai);
+	reveille_attentes(req, c, numero, pid_Serveur);
+}
+
+/**
+ * \fn void refuse(Requete *req)
+ * \brief Enregistre le refus d'une demande qui vient d'arriver et la met en attente.
+ *
+ * \param req Pointeur sur la demande refusee.
+ */
+void refuse(Requete *req)
+{
+	trace_requete(req, 0);
+	stats_refus(req);
+	met_en_attente(req);
+}
+
+/**
+ * \fn void autorise(Requete *req, int numero, long long delai)
+ * \brief Programme l'envoi de l'autorisation d'avancer a la voiture ayant emis la requete.
+ *
+ * \param req Pointeur sur la requete de la voiture.
+ * \param numero Le numero du carrefour.
+ * \param delai Le delai avant l'envoi (en microseconde).
+ */
+void autorise(Requete *req, int numero, long long delai)
+{
+	Reponse rep;
+
+	rep.type = req->pidEmetteur;
+	rep.autorisation = 1;
+	envoie_reponse(&rep, client_voiture(req->voiture), numero, maintenant() + delai);
+}
+
+/**
+ * \fn void envoie_reponse(Reponse *rep, int client, int numero, long long date)
+ * \brief Depose une reponse dans la file du carrefour a une date donnee, sans jamais bloquer.
+ *
+ * Une reponse dont la date n'est pas atteinte est programmee : elle sera deposee par envoie_differees().
+ * De meme si la file est pleine (de requetes que seul le carrefour peut consommer), attendre provoquerait un interblocage : la reponse est alors differee.
+ * Les reponses en attente sont rangees par date (a date egale, dans l'ordre d'envoi). Avec le transport par anneaux, une reponse n'est jamais differee pour une file pleine (les boites de reponse ne sont jamais pleines).
+ *
+ * \param rep Pointeur sur la reponse.
+ * \param client Le client destinataire (voir client_voiture()).
+ * \param numero Le numero du carrefour.
+ * \param date La date d'envoi au plus tot (horloge monotone, en microseconde).
+ */
+void envoie_reponse(Reponse *rep, int client, int numero, long long date)
+{
+	Differee *d, *p;
+
+	if ((differees_tete == NULL || differees_tete->date > date) && date <= maintenant() && transport->depose_reponse(numero, client, rep, 0) == 0) {
+		compte_message();
+		return;
+	}
+
+	d = malloc(sizeof(Differee));
+	if (d == NULL) {
+		perror("Pb malloc reponse");
+		exit(1);
+	}
+	d->rep = *rep;
+	d->client = client;
+	d->date = date;
+
+	if (differees_tete == NULL || differees_tete->date > date) {
+		d->suivant = differees_tete;
+		differees_tete = d;
+	} else {
+		for (p = differees_tete; p->suivant != NULL && p->suivant->date <= date; p = p->suivant);
+		d->suivant = p->suivant;
+		p->suivant = d;
+	}
+	if (d->suivant == NULL)
+		differees_queue = d;
+}
+
+/**
+ * \fn void envoie_differees(int numero)
+ * \brief Depose, dans l'ordre, les reponses differees dont la date est atteinte, tant que la file du carrefour a de la place.
+ *
+ * \param numero Le numero du carrefour.
+ */
+void envoie_differees(int numero)
+{
+	Differee *d;
+	long long date = maintenant();
+
+	while (differees_tete != NULL && differees_tete->date <= date && transport->depose_reponse(numero, differees_tete->client, &differees_tete->rep, 0) == 0) {
+		compte_message();
+		d = differees_tete;
+		differees_tete = d->suivant;
+		free(d);
+	}
+
+	if (differees_tete == NULL)
+		differees_queue = NULL;
+}
+
+/**
+ * \fn void met_en_attente(Requete *req)
+ * \brief Place une demande refusee en fin de file d'attente du croisement demande.
+ *
+ * \param req Pointeur sur la requete refusee.
+ */
+void met_en_attente(Requete *req)
+{
+	Attente *a;
+	int i = req->croisement;
+
+	a = malloc(sizeof(Attente));
+	if (a == NULL) {
+		perror("Pb malloc attente");
+		exit(1);
+	}
+	a->req = *req;
+	a->suivant = NULL;
+
+	if (attentes_queue[i] == NULL)
+		attentes_tete[i] = a;
+	else
+		attentes_queue[i]->suivant = a;
+	attentes_queue[i] = a;
+}
+
+/**
+ * \fn void remet_en_attente(Requete *req)
+ * \brief Replace en tete de file d'attente une demande qui en avait ete reprise et que le serveur a refusee.
+ *
+ * \param req Pointeur sur la requete refusee.
+ */
+void remet_en_attente(Requete *req)
+{
+	Attente *a;
+	int i = req->croisement;
+
+	a = malloc(sizeof(Attente));
+	if (a == NULL) {
+		perror("Pb malloc attente");
+		exit(1);
+	}
+	a->req = *req;
+	a->suivant = attentes_tete[i];
+
+	if (attentes_queue[i] == NULL)
+		attentes_queue[i] = a;
+	attentes_tete[i] = a;
+}
+
+/**
+ * \fn void demande_parcours(Requete *req, Carrefour *c, int numero)
+ * \brief Traite une reservation de parcours : engage la voiture sur sa voie, ou met la demande en attente.
+ *
+ * Une reservation n'est accordee que si elle ne croise aucune reservation en attente (ni n'en suit une sur la meme voie) : les parcours qui se croisent sont servis dans l'ordre d'arrivee.
+ *
+ * \param req Pointeur sur la demande de la voiture.
+ * \param c Pointeur sur le carrefour.
+ * \param numero Le numero du carrefour.
+ */
+void demande_parcours(Requete *req, Carrefour *c, int numero)
+{
+	Attente *a;
+	unsigned int masque = masque_parcours(req->voie), attendus = 0;
+
+	for (a = reservations_tete; a != NULL; a = a->suivant)
+		attendus |= masque_parcours(a->req.voie);
+
+	if ((masque & attendus) == 0 && reserve_parcours(c, req->voie) == 1) {
+		autorise(req, numero, MINPAUSE);
+		return;
+	}
+
+	trace_requete(req, 0);
+
+	a = malloc(sizeof(Attente));
+	if (a == NULL) {
+		perror("Pb malloc attente");
+		exit(1);
+	}
+	a->req = *req;
+	a->suivant = NULL;
+
+	if (reservations_queue == NULL)
+		reservations_tete = a;
+	else
+		reservations_queue->suivant = a;
+	reservations_queue = a;
+}
+
+/**
+ * \fn void reveille_reservations(Carrefour *c, int numero)
+ * \brief Accorde, dans l'ordre d'arrivee, les reservations de parcours en attente dont les croisements sont libres.
+ *
+ * Une reservation qui reste en attente bloque les croisements de sa voie pour les suivantes : une voie n'est jamais doublee par un parcours qui la croise.
+ *
+ * \param c Pointeur sur le carrefour.
+ * \param numero Le numero du carrefour.
+ */
+void reveille_reservations(Carrefour *c, int numero)
+{
+	Attente *a, *precedent = NULL, *suivant;
+	unsigned int masque, attendus = 0;
+
+	for (a = reservations_tete; a != NULL; a = suivant) {
+		suivant = a->suivant;
+		masque = masque_parcours(a->req.voie);
+
+		if ((masque & attendus) != 0 || reserve_parcours(c, a->req.voie) == 0) {
+			attendus |= masque;
+			precedent = a;
+			continue;
+		}
+
+		if (precedent == NULL)
+			reservations_tete = suivant;
+		else
+			precedent->suivant = suivant;
+		if (reservations_queue == a)
+			reservations_queue = precedent;
+
+		autorise(&a->req, numero, 0);
+		free(a);
+	}
+}
+
+/**
+ * \fn void reveille_attentes(Requete *req, Carrefour *c, int numero, pid_t pid_Serveur)
+ * \brief Reveille les demandes en attente qui peuvent etre satisfaites apres la mise a jour du carrefour par une requete.
+ *
+ * Les croisements touches par la requete (le croisement et le croisement precedent) sont examines, sauf ceux qui ont deja une demande en cours (le retour de sa decision les examinera).
+ * Pour chacun, les demandes en attente sont parcourues dans l'ordre d'arrivee : la premiere que decision() juge satisfaisable est soumise au serveur (soumet()).
+ * En ADMISSION_LOCALE, toutes celles que decision() juge satisfaisables sont directement appliquees au carrefour et debloquent la voiture.
+ * Une demande autorisee pouvant a son tour liberer de la place (croisement precedent, file avant, croisement lui meme), les croisements qu'elle touche sont examines a nouveau.
+ * En ordre par tickets, une demande qui ne peut pas etre satisfaite bloque les demandes suivantes sur la meme case : une place liberee revient toujours a la plus ancienne.
+ * Avec l'evitement des interblocages, une mise a jour peut rendre sure une demande sur n'importe quel croisement : tous les croisements qui ont des demandes en attente sont alors examines.
+ *
+ * \param req Pointeur sur la requete qui vient d'etre appliquee au carrefour, NULL apres un changement de phase des feux (tous les croisements qui ont des demandes en attente sont examines).
+ * \param c Pointeur sur le carrefour.
+ * \param numero Le numero du carrefour.
+ * \param pid_Serveur Le pid du processus serveur.
+ */
+void reveille_attentes(Requete *req, Carrefour *c, int numero, pid_t pid_Serveur)
+{
+	int a_examiner[25] = {0};
+	int k, libere, bloquees, restant = 0;
+	Attente *a, *precedent, *suivant;
+
+	if (evitement == 1 || req == NULL) {
+		restant = marque_attentes(a_examiner);
+	} else {
+		if (req->croisement != -1) {
+			a_examiner[req->croisement] = 1;
+			restant++;
+		}
+		if (req->croisement_precedent != -1 && req->croisement_precedent != req->croisement) {
+			a_examiner[req->croisement_precedent] = 1;
+			restant++;
+		}
+	}
+
+	while (restant > 0) {
+		for (k=0;k<25 && a_examiner[k] == 0;k++);
+		a_examiner[k] = 0;
+		restant--;
 
-		if (req.type == MESSDEMANDE) {
-			req_serveur = req;
-			req_serveur.type = pid_Serveur;
-			req_serveur.pidEmetteur = getpid();
-			msgsnd(msg_serveur,&req_serveur,tailleReq,0);
-			msgrcv(msg_serveur,&rep,tailleRep,getpid(),0);
-			if (rep.autorisation == 1) {
-				maj_carrefour(&req, c);
+		libere = 0;
+		bloquees = 0;
+		precedent = NULL;
+		for (a = attentes_tete[k]; a != NULL && origine_en_cours[k] == AUCUNE_DEMANDE; a = suivant) {
+			suivant = a->suivant;
+
+			if ((ordre == ORDRE_TICKETS && (bloquees & (1 << case_requete(&a->req))) != 0) || decision(c, &a->req) == 0) {
+				bloquees |= 1 << case_requete(&a->req);
+				precedent = a;
+				continue;
+			}
+
+			if (precedent == NULL)
+				attentes_tete[k] = suivant;
+			else
+				precedent->suivant = suivant;
+			if (attentes_queue[k] == a)
+				attentes_queue[k] = precedent;
+
+			if (admission != ADMISSION_LOCALE) {
+				soumet(&a->req, DEMANDE_REPRISE, pid_Serveur);
+				free(a);
+				break;
 			}
-			rep.type = req.pidEmetteur;
-			usleep(MINPAUSE);
-			msgsnd(msg_carrefour[numero-1],&rep,tailleRep,0);
+
+			maj_carrefour(&a->req, c);
+			autorise(&a->req, numero, 0);
+			libere = 1;
+
+			if (a->req.croisement_precedent != -1 && a->req.croisement_precedent != k && a_examiner[a->req.croisement_precedent] == 0) {
+				a_examiner[a->req.croisement_precedent] = 1;
+				restant++;
+			}
+
+			free(a);
+		}
+
+		if (libere == 1 && evitement == 1) {
+			restant += marque_attentes(a_examiner);
+		} else if (libere == 1) {
+			a_examiner[k] = 1;
+			restant++;
 		}
 	}
 }
 
+/**
+ * \fn int marque_attentes(int a_examiner[25])
+ * \brief Marque a examiner tous les croisements qui ont des demandes en attente.
+ *
+ * \param a_examiner Les croisements deja marques (1 : a examiner).
+ *
+ * \return Le nombre de croisements nouvellement marques.
+ */
+int marque_attentes(int a_examiner[25])
+{
+	int k, marques = 0;
+
+	for (k=0;k<25;k++) {
+		if (attentes_tete[k] != NULL && a_examiner[k] == 0) {
+			a_examiner[k] = 1;
+			marques++;
+		}
+	}
+
+	return marques;
+}
+
+/**
+ * \fn int demandes_en_attente()
+ * \brief Indique si des demandes attendent sur l'un des croisements du carrefour.
+ *
+ * \return 1 si au moins une demande est en attente, 0 sinon.
+ */
+int demandes_en_attente()
+{
+	int k;
+
+	for (k=0;k<25;k++)
+		if (attentes_tete[k] != NULL)
+			return 1;
+
+	return 0;
+}
+
+/**
+ * \fn int case_en_attente(Requete *req)
+ * \brief Indique si une demande attend deja la case du croisement visee par une requete.
+ *
+ * \param req Pointeur sur la requete (MESSDEMANDE).
+ *
+ * \return 1 si une demande plus ancienne attend la meme case, 0 sinon.
+ */
+int case_en_attente(Requete *req)
+{
+	Attente *a;
+	int k = case_requete(req);
+
+	for (a = attentes_tete[req->croisement]; a != NULL; a = a->suivant)
+		if (case_requete(&a->req) == k)
+			return 1;
+
+	return 0;
+}
+
 /**
  * \fn void maj_carrefour(Requete *req, Carrefour *c)
  * \brief Met a jour le carrefour avec les informations de la requete recue.
  *
+ * Seuls le croisement et le croisement precedent concernes par la requete sont verrouilles : les autres croisements (et les autres carrefours) restent accessibles.
+ * En ADMISSION_LOCALE, aucun autre processus n'accede au carrefour : aucun verrou n'est pris.
+ *
  * \param req Pointeur sur la requete recue.
  * \param c Pointeur sur le carrefour correspondant.
  */
 void maj_carrefour(Requete *req, Carrefour *c)
 {
-	P(MUTEX);
+	if (admission == ADMISSION_LOCALE) {
+		maj_croisements(req, c);
+		return;
+	}
+
+	P_croisements(req->carrefour, req->croisement, req->croisement_precedent);
+	maj_croisements(req, c);
+	V_croisements(req->carrefour, req->croisement, req->croisement_precedent);
+}
 
+/**
+ * \fn void maj_croisements(Requete *req, Carrefour *c)
+ * \brief Met a jour les croisements du carrefour avec les informations de la requete recue, sans synchronisation.
+ *
+ * L'appelant doit garantir l'acces exclusif au carrefour (voir maj_carrefour()).
+ * Une demande appliquee qui ferme un cycle de cases pleines est comptee comme interblocage (voir detecte_interblocage()).
+ * Une demande qui porte un ticket passe la case au ticket suivant.
+ *
+ * \param req Pointeur sur la requete recue.
+ * \param c Pointeur sur le carrefour correspondant.
+ */
+void maj_croisements(Requete *req, Carrefour *c)
+{
 	int i = req->croisement;
 	int j = req->croisement_precedent;
 	int etat = req->traverse;
@@ -109,6 +654,7 @@ void maj_carrefour(Requete *req, Carrefour *c)
 			c->croisements[i].avantV--;
 		}
 		c->croisements[i].etat = 1;
+		c->croisements[i].occupant = orientation;
 	} else if (etat == APRES) {
 		c->croisements[i].etat = 0;
 		if (orientation == HO) {
@@ -117,8 +663,231 @@ void maj_carrefour(Requete *req, Carrefour *c)
 			c->croisements[i].apresV++;
 		}
 	}
-	
-	V(MUTEX);
+
+	if (type == MESSDEMANDE) {
+		sert_ticket(c, req);
+		detecte_interblocage(c, req);
+	}
+}
+
+/**
+ * \fn int reserve_compteur(int *compteur, int max)
+ * \brief Incremente un compteur d'un croisement s'il est inferieur a max, par compare-and-swap.
+ *
+ * \param compteur Pointeur sur le compteur (dans le segment de memoire partagee du carrefour).
+ * \param max La valeur que le compteur ne doit pas atteindre.
+ *
+ * \return 1 si la place a ete reservee, 0 si le compteur a atteint max.
+ */
+int reserve_compteur(int *compteur, int max)
+{
+	int valeur = __atomic_load_n(compteur, __ATOMIC_RELAXED);
+
+	while (valeur < max) {
+		if (__atomic_compare_exchange_n(compteur, &valeur, valeur+1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+			return 1;
+	}
+
+	return 0;
+}
+
+/**
+ * \fn void libere_apres(Carrefour *c, int j, int orientation)
+ * \brief Libere atomiquement une place de la file apres un croisement.
+ *
+ * \param c Pointeur sur le carrefour.
+ * \param j L'indice du croisement (-1 si aucun).
+ * \param orientation L'orientation de la file (HO / VE).
+ */
+void libere_apres(Carrefour *c, int j, int orientation)
+{
+	if (j == -1)
+		return;
+
+	if (orientation == HO)
+		__atomic_sub_fetch(&c->croisements[j].apresH, 1, __ATOMIC_RELEASE);
+	else
+		__atomic_sub_fetch(&c->croisements[j].apresV, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * \fn int reserve_croisement(Requete *req, Carrefour *c)
+ * \brief Decide et met a jour le carrefour en une seule operation atomique par compteur, sans verrou ni serveur.
+ *
+ * Equivalent de decision() suivie de maj_croisements() :
+ * - AVANT : reserve une place dans la file avant (compare-and-swap), puis libere la file apres du croisement precedent.
+ * - PENDANT : passe l'etat du croisement de 0 a 1 (compare-and-swap), puis libere la place de la file avant.
+ * - APRES : reserve une place dans la file apres (compare-and-swap), puis remet l'etat du croisement a 0.
+ * - MESSSORT : libere la file apres du croisement precedent (en reservation de parcours, la place de la voiture sur sa voie).
+ * - MESSRESERVE : engage la voiture sur sa voie (voir reserve_parcours()).
+ *
+ * Les interblocages sont detectes comme avec maj_croisements(), sur des compteurs lus sans verrou.
+ * Une demande qui porte un ticket n'est tentee que si c'est son tour (a_son_tour()) : aucune autre demande ne peut alors reserver la meme case.
+ * Avec les feux, une traversee depuis une ligne d'arret n'est tentee que si sa phase est verte (feu_vert()).
+ *
+ * \param req Pointeur sur la requete de la voiture.
+ * \param c Pointeur sur le carrefour (segment de memoire partagee).
+ *
+ * \return 1 si la voiture peut avancer, 0 sinon (rien n'a ete modifie).
+ */
+int reserve_croisement(Requete *req, Carrefour *c)
+{
+	Croisement *x;
+	int libre = 0;
+
+	if (req->type == MESSRESERVE)
+		return reserve_parcours(c, req->voie);
+
+	if (req->type == MESSSORT && reservation == 1) {
+		libere_parcours(c, req->voie);
+		return 1;
+	}
+
+	if (req->type == MESSSORT) {
+		libere_apres(c, req->croisement_precedent, req->croisement_precedent_orientation);
+		return 1;
+	}
+
+	if (a_son_tour(c, req) == 0 || (feux == 1 && feu_vert(c, req) == 0))
+		return 0;
+
+	x = &c->croisements[req->croisement];
+
+	if (req->traverse == AVANT) {
+		if (!reserve_compteur(req->croisement_orientation == HO ? &x->avantH : &x->avantV, MAXFILE))
+			return 0;
+		libere_apres(c, req->croisement_precedent, req->croisement_precedent_orientation);
+	} else if (req->traverse == PENDANT) {
+		if (!__atomic_compare_exchange_n(&x->etat, &libre, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+			return 0;
+		__atomic_store_n(&x->occupant, req->croisement_orientation, __ATOMIC_RELAXED);
+		if (req->croisement_orientation == HO)
+			__atomic_sub_fetch(&x->avantH, 1, __ATOMIC_RELEASE);
+		else
+			__atomic_sub_fetch(&x->avantV, 1, __ATOMIC_RELEASE);
+	} else if (req->traverse == APRES) {
+		if (!reserve_compteur(req->croisement_orientation == HO ? &x->apresH : &x->apresV, MAXFILE))
+			return 0;
+		__atomic_store_n(&x->etat, 0, __ATOMIC_RELEASE);
+	}
+
+	sert_ticket(c, req);
+	detecte_interblocage(c, req);
+	return 1;
+}
+
+/**
+ * \fn void initialise_parcours()
+ * \brief Recense, pour chaque voie, les voies qui la croisent (au moins un croisement commun), sous forme de masques de l'occupation d'un carrefour.
+ */
+void initialise_parcours()
+{
+	int v, u;
+
+	for (v=1;v<=12;v++) {
+		compteurs_conflit[v-1] = 0;
+		attentes_conflit[v-1] = 0;
+		for (u=1;u<=12;u++) {
+			if (u != v && (masque_parcours(u) & masque_parcours(v)) != 0) {
+				compteurs_conflit[v-1] |= COMPTEUR_PARCOURS(u);
+				attentes_conflit[v-1] |= ATTENTE_PARCOURS(u);
+			}
+		}
+	}
+}
+
+/**
+ * \fn int reserve_parcours(Carrefour *c, int voie)
+ * \brief Engage une voiture sur une voie d'un carrefour, par compare-and-swap sur l'occupation du carrefour.
+ *
+ * Les voitures d'une meme voie se suivent : la reservation est accordee tant qu'aucune voiture n'est engagee sur une voie qui la croise (et dans la limite de MAX_PARCOURS voitures par voie).
+ * Une reservation refusee marque sa voie en attente : les voies qui la croisent n'acceptent plus de nouvelle voiture (sauf si elles sont elles memes en attente) et finissent par se vider.
+ * La marque est effacee par la premiere reservation accordee sur la voie.
+ *
+ * \param c Pointeur sur le carrefour (segment de memoire partagee).
+ * \param voie Le numero de la voie (1<=voie<=12).
+ *
+ * \return 1 si la voiture est engagee sur la voie, 0 sinon (seule la marque d'attente de la voie a pu etre posee).
+ */
+int reserve_parcours(Carrefour *c, int voie)
+{
+	unsigned long long occupation = __atomic_load_n(&c->occupation, __ATOMIC_RELAXED);
+	unsigned long long compteur = COMPTEUR_PARCOURS(voie), attente = ATTENTE_PARCOURS(voie);
+
+	while (1) {
+		if ((occupation & compteurs_conflit[voie-1]) != 0 || (occupation & compteur) == compteur
+				|| ((occupation & attente) == 0 && (occupation & attentes_conflit[voie-1]) != 0)) {
+			if ((occupation & attente) != 0
+					|| __atomic_compare_exchange_n(&c->occupation, &occupation, occupation | attente, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				return 0;
+			continue;
+		}
+		if (__atomic_compare_exchange_n(&c->occupation, &occupation, (occupation + (1ULL << 4*(voie-1))) & ~attente, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+			return 1;
+	}
+}
+
+/**
+ * \fn void libere_parcours(Carrefour *c, int voie)
+ * \brief Libere atomiquement la place d'une voiture engagee sur une voie par reserve_parcours().
+ *
+ * Une voie sans croisement n'est jamais reservee : sa sortie ne libere rien.
+ *
+ * \param c Pointeur sur le carrefour.
+ * \param voie Le numero de la voie.
+ */
+void libere_parcours(Carrefour *c, int voie)
+{
+	if (voies[voie-1].nombre == 0)
+		return;
+
+	__atomic_sub_fetch(&c->occupation, 1ULL << 4*(voie-1), __ATOMIC_RELEASE);
+}
+
+/**
+ * \fn int prend_ticket(Carrefour *c, Requete *req)
+ * \brief Distribue atomiquement le prochain ticket de la case visee par une demande.
+ *
+ * Une voiture prend un seul ticket par demande, a sa premiere emission, et le garde jusqu'a son autorisation : les demandes d'une case sont ainsi servies par anciennete, et non selon la voiture qui reessaie la premiere.
+ *
+ * \param c Pointeur sur le carrefour (segment de memoire partagee).
+ * \param req Pointeur sur la demande (MESSDEMANDE).
+ *
+ * \return Le ticket de la demande.
+ */
+int prend_ticket(Carrefour *c, Requete *req)
+{
+	return __atomic_fetch_add(&c->croisements[req->croisement].tickets[case_requete(req)], 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * \fn int a_son_tour(Carrefour *c, Requete *req)
+ * \brief Indique si une demande peut etre examinee : elle ne porte pas de ticket, ou son ticket est celui que sert sa case.
+ *
+ * \param c Pointeur sur le carrefour.
+ * \param req Pointeur sur la demande (MESSDEMANDE).
+ *
+ * \return 1 si la demande peut etre examinee, 0 si une demande plus ancienne attend la meme case.
+ */
+int a_son_tour(Carrefour *c, Requete *req)
+{
+	if (req->ticket == -1)
+		return 1;
+
+	return __atomic_load_n(&c->croisements[req->croisement].servis[case_requete(req)], __ATOMIC_ACQUIRE) == req->ticket;
+}
+
+/**
+ * \fn void sert_ticket(Carrefour *c, Requete *req)
+ * \brief Passe la case d'une demande accordee au ticket suivant (sans effet si la demande ne porte pas de ticket).
+ *
+ * \param c Pointeur sur le carrefour.
+ * \param req Pointeur sur la demande accordee.
+ */
+void sert_ticket(Carrefour *c, Requete *req)
+{
+	if (req->ticket != -1)
+		__atomic_add_fetch(&c->croisements[req->croisement].servis[case_requete(req)], 1, __ATOMIC_RELEASE);
 }
 
 /**
@@ -1,10 +1,96 @@
 #ifndef __CARREFOUR__
 #define __CARREFOUR__
 
+#include "project.h"
+
+/*! Le croisement n'a pas de demande en cours aupres du serveur. */
+#define AUCUNE_DEMANDE 0
+/*! La demande en cours vient d'arriver d'une voiture. */
+#define DEMANDE_RECUE 1
+/*! La demande en cours a ete reprise d'une file d'attente (voir reveille_attentes()). */
+#define DEMANDE_REPRISE 2
+
+/*! Le nombre maximal de voitures engagees sur une meme voie d'un carrefour en reservation de parcours (compteur de 4 bits). */
+#define MAX_PARCOURS 15
+/*! Le compteur de voitures engagees sur la voie v (1 a 12) dans l'occupation d'un carrefour (bits 4*(v-1) a 4*v-1). */
+#define COMPTEUR_PARCOURS(v) (0xFULL << 4*((v)-1))
+/*! L'indicateur de reservation refusee sur la voie v (1 a 12) dans l'occupation d'un carrefour (bit 48+v-1). */
+#define ATTENTE_PARCOURS(v) (1ULL << (48+(v)-1))
+
+/**
+ * \struct Attente
+ * \brief Represente une demande refusee, en attente sur un croisement (element d'une file chainee).
+ */
+typedef struct Attente {
+	Requete req;	/*!< La demande refusee. */
+	struct Attente *suivant;	/*!< La demande suivante dans la file. */
+} Attente;
+
+/**
+ * \struct Differee
+ * \brief Represente une reponse programmee, ou qui n'a pas pu etre deposee dans la file pleine du carrefour (element d'une file chainee triee par date).
+ */
+typedef struct Differee {
+	Reponse rep;	/*!< La reponse a deposer. */
+	int client;	/*!< Le client destinataire de la reponse. */
+	long long date;	/*!< La date d'envoi au plus tot (horloge monotone, en microseconde). */
+	struct Differee *suivant;	/*!< La reponse suivante dans la file. */
+} Differee;
+
 void carrefour(int numero, pid_t pid_Serveur);
 
+void soumet(Requete *req, int origine, pid_t pid_Serveur);
+
+void decision_recue(Requete *decidee, int autorisation, Carrefour *c, int numero, pid_t pid_Serveur);
+
+void accorde(Requete *req, Carrefour *c, int numero, pid_t pid_Serveur, long long delai);
+
+void refuse(Requete *req);
+
+void autorise(Requete *req, int numero, long long delai);
+
+void envoie_reponse(Reponse *rep, int client, int numero, long long date);
+
+void envoie_differees(int numero);
+
+void met_en_attente(Requete *req);
+
+void remet_en_attente(Requete *req);
+
+void demande_parcours(Requete *req, Carrefour *c, int numero);
+
+void reveille_reservations(Carrefour *c, int numero);
+
+void reveille_attentes(Requete *req, Carrefour *c, int numero, pid_t pid_Serveur);
+
+int marque_attentes(int a_examiner[25]);
+
+int demandes_en_attente();
+
+int case_en_attente(Requete *req);
+
 void maj_carrefour(Requete *req, Carrefour *c);
 
+void maj_croisements(Requete *req, Carrefour *c);
+
+int reserve_compteur(int *compteur, int max);
+
+void libere_apres(Carrefour *c, int j, int orientation);
+
+int reserve_croisement(Requete *req, Carrefour *c);
+
+void initialise_parcours();
+
+int reserve_parcours(Carrefour *c, int voie);
+
+void libere_parcours(Carrefour *c, int voie);
+
+int prend_ticket(Carrefour *c, Requete *req);
+
+int a_son_tour(Carrefour *c, Requete *req);
+
+void sert_ticket(Carrefour *c, Requete *req);
+
 void affiche_carrefour(Carrefour *c);
 
 #endif
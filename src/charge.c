@@ -0,0 +1,492 @@
+/**
+ * \file charge.c
+ * \brief Contient la description des voitures a simuler (la charge) : arguments du programme ou fichier de charge (option "-w").
+ *
+ * Un fichier de charge est un entete suivi d'arrivees de taille fixe (date, voie, carrefour).
+ * Il est projete en memoire : il peut decrire des millions de voitures sans etre lu ni copie en entier.
+ *
+ * En charge ouverte (options "-o" et "-O"), les voitures ne sont plus decrites a l'avance : elles arrivent en continu aux entrees de la carte (voies qui arrivent du bord de la grille) pendant une duree donnee.
+ * Les arrivees de chaque entree suivent un processus de Poisson, de debit constant par periode ; elles ne dependent pas de l'avancement de la simulation.
+ * Les numeros de voiture sont recycles : une voiture sortie rend son numero, et une arrivee qui ne trouve aucun numero libre (la carte est saturee) est refusee et comptee comme telle.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "project.h"
+#include "main.h"
+#include "interface.h"
+#include "charge.h"
+#include "alea.h"
+#include "voiture.h"
+#include "topologie.h"
+
+int charge_nombre = 0;
+int charge_ouverte = 0;
+int charge_en_route = 0;
+
+/*! Les voies et carrefours passes en arguments (NULL pour des voitures aleatoires). */
+char **charge_argv = NULL;
+/*! Les arrivees du fichier de charge projete en memoire (NULL si aucun fichier). */
+Arrivee *charge_arrivees = NULL;
+
+/*! Les entrees de la carte en charge ouverte (voie et carrefour, date inutilisee). */
+Arrivee *entrees;
+/*! Le nombre d'entrees de la carte. */
+int nb_entrees;
+/*! Les periodes de debits constants, par date de debut croissante (la premiere commence a 0). */
+PeriodeCharge *periodes;
+/*! Le nombre de periodes. */
+int nb_periodes;
+/*! La periode de la prochaine arrivee. */
+int periode_courante;
+/*! La duree de la generation des arrivees (en microseconde). */
+long long duree_ouverte;
+/*! La date de la derniere arrivee generee (en microseconde). */
+long long date_ouverte;
+/*! Le flux aleatoire des arrivees (distinct de ceux des voitures). */
+Alea alea_ouverte;
+/*! Vaut 1 lorsque toutes les arrivees ont ete generees. */
+int generation_finie;
+/*! Les numeros de voiture libres (pile). */
+int *numeros_libres;
+/*! Le nombre de numeros libres. */
+int nb_libres;
+/*! Le nombre d'arrivees generees. */
+long long arrivees_offertes;
+/*! Le nombre d'arrivees refusees faute de numero libre. */
+long long arrivees_refusees;
+/*! Le nombre de voitures sorties pendant la generation. */
+long long sorties_fenetre;
+/*! Le plus grand nombre de voitures en route. */
+int max_en_route;
+/*! Protege les numeros libres et les compteurs (les arrivees et les sorties peuvent venir de threads differents). */
+pthread_mutex_t verrou_ouverte = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * \fn void charge_arguments(int nbVoitures, char *argv[])
+ * \brief Decrit la charge a partir des arguments du programme.
+ *
+ * Si argv est NULL, nbVoitures voitures arrivent a la date 0 avec une voie et un carrefour aleatoires.
+ * Si argv est non NULL, nbVoitures voitures arrivent a la date 0 avec les voies et carrefours correspondants (arguments verifies par verif_arguments()).
+ *
+ * \param nbVoitures Le nombre de voitures.
+ * \param argv Le tableau des voies et carrefours le cas echeant.
+ */
+void charge_arguments(int nbVoitures, char *argv[])
+{
+	charge_nombre = nbVoitures;
+	charge_argv = argv;
+}
+
+/**
+ * \fn void charge_fichier(char *chemin)
+ * \brief Projette un fichier de charge en memoire et verifie son contenu.
+ *
+ * Quitte le programme si le fichier est invalide.
+ *
+ * \param chemin Le chemin du fichier de charge.
+ */
+void charge_fichier(char *chemin)
+{
+	EnteteCharge *entete;
+	struct stat infos;
+	long long i;
+	int fd;
+
+	fd = open(chemin, O_RDONLY);
+	if (fd == -1 || fstat(fd, &infos) == -1)
+		erreurFin("Pb ouverture charge");
+	if (infos.st_size < sizeof(EnteteCharge)) {
+		printf("%s n'est pas un fichier de charge.\n", chemin);
+		exit(-1);
+	}
+
+	entete = mmap(NULL, infos.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (entete == MAP_FAILED)
+		erreurFin("Pb mmap charge");
+	close(fd);
+
+	if (memcmp(entete->magique, MAGIQUE_CHARGE, 8) != 0 || entete->version != VERSION_CHARGE || entete->taille != sizeof(Arrivee)
+			|| entete->nombre <= 0 || entete->nombre > 0x7FFFFFFF || sizeof(EnteteCharge) + entete->nombre * sizeof(Arrivee) > infos.st_size) {
+		printf("%s n'est pas un fichier de charge compatible (version %d attendue).\n", chemin, VERSION_CHARGE);
+		exit(-1);
+	}
+
+	charge_arrivees = (Arrivee *) (entete + 1);
+	charge_nombre = entete->nombre;
+
+	for (i=0;i<charge_nombre;i++) {
+		if (charge_arrivees[i].date < 0 || !(charge_arrivees[i].voie > 0 && charge_arrivees[i].voie < 13 || charge_arrivees[i].voie == -1)
+				|| !(charge_arrivees[i].carrefour > 0 && charge_arrivees[i].carrefour <= nb_carrefours || charge_arrivees[i].carrefour == -1)) {
+			printf("Arrivee %lld invalide dans %s.\n", i, chemin);
+			exit(-1);
+		}
+	}
+}
+
+/**
+ * \fn void arrivee_voiture(int i, Arrivee *a)
+ * \brief Retourne l'arrivee d'une voiture de la charge.
+ *
+ * \param i Le numero de la voiture (0<=i<charge_nombre).
+ * \param a Pointeur sur l'arrivee qui va etre renseignee.
+ */
+void arrivee_voiture(int i, Arrivee *a)
+{
+	if (charge_arrivees != NULL) {
+		*a = charge_arrivees[i];
+	} else if (charge_argv != NULL) {
+		a->date = 0;
+		a->voie = atoi(charge_argv[1+(i*2)]);
+		a->carrefour = atoi(charge_argv[2+(i*2)]);
+	} else {
+		a->date = 0;
+		a->voie = -1;
+		a->carrefour = -1;
+	}
+}
+
+/**
+ * \fn void initialise_entrees(long long duree)
+ * \brief Recense les entrees de la carte et prepare les numeros libres et le flux des arrivees d'une charge ouverte.
+ *
+ * Une entree est une voie d'un carrefour qui arrive du bord de la grille : la voie v arrive de l'Ouest, du Sud, de l'Est ou du Nord selon (v-1)/3.
+ *
+ * \param duree La duree de la generation (en microseconde).
+ */
+void initialise_entrees(long long duree)
+{
+	int provenance[] = {OUEST, SUD, EST, NORD};
+	int c, v, i;
+
+	entrees = malloc(nb_carrefours * 12 * sizeof(Arrivee));
+	numeros_libres = malloc(charge_nombre * sizeof(int));
+	if (entrees == NULL || numeros_libres == NULL)
+		erreurFin("Pb malloc charge ouverte");
+
+	nb_entrees = 0;
+	for (c=1;c<=nb_carrefours;c++) {
+		for (v=1;v<=12;v++) {
+			if (voisins[(c-1)*4 + provenance[(v-1)/3]] == -1) {
+				entrees[nb_entrees].date = 0;
+				entrees[nb_entrees].voie = v;
+				entrees[nb_entrees].carrefour = c;
+				nb_entrees++;
+			}
+		}
+	}
+	if (nb_entrees == 0) {
+		printf("La grille n'a aucune entree : la charge ouverte est impossible.\n");
+		exit(-1);
+	}
+
+	for (i=0;i<charge_nombre;i++)
+		numeros_libres[i] = charge_nombre-1-i;
+	nb_libres = charge_nombre;
+
+	charge_ouverte = 1;
+	duree_ouverte = duree;
+	date_ouverte = 0;
+	periode_courante = 0;
+	initialise_alea(&alea_ouverte, -2);
+}
+
+/**
+ * \fn void ajoute_periode(long long debut)
+ * \brief Ajoute une periode de debits qui commence a une date donnee, avec les debits de la periode precedente (nuls pour la premiere).
+ *
+ * \param debut La date de debut de la periode (en microseconde).
+ */
+void ajoute_periode(long long debut)
+{
+	PeriodeCharge *p;
+
+	periodes = realloc(periodes, (nb_periodes+1) * sizeof(PeriodeCharge));
+	if (periodes == NULL)
+		erreurFin("Pb malloc charge ouverte");
+	p = &periodes[nb_periodes];
+	p->debut = debut;
+	p->total = 0;
+	p->cumules = calloc(nb_entrees, sizeof(double));
+	if (p->cumules == NULL)
+		erreurFin("Pb malloc charge ouverte");
+	if (nb_periodes > 0)
+		memcpy(p->cumules, periodes[nb_periodes-1].cumules, nb_entrees * sizeof(double));
+	nb_periodes++;
+}
+
+/**
+ * \fn void cumule_periodes()
+ * \brief Remplace les debits de chaque entree par les debits cumules, qui servent au tirage de l'entree d'une arrivee.
+ */
+void cumule_periodes()
+{
+	PeriodeCharge *p;
+	int i, j;
+
+	for (i=0;i<nb_periodes;i++) {
+		p = &periodes[i];
+		for (j=1;j<nb_entrees;j++)
+			p->cumules[j] += p->cumules[j-1];
+		p->total = p->cumules[nb_entrees-1];
+	}
+}
+
+/**
+ * \fn void charge_debit(double debit, long long duree)
+ * \brief Decrit une charge ouverte de debit constant, le meme pour toutes les entrees de la carte (option "-o").
+ *
+ * A appeler apres initialise_topologie() et charge_arguments() (qui fixe le nombre maximal de voitures en route).
+ *
+ * \param debit Le debit de chaque entree (en voiture par seconde).
+ * \param duree La duree de la generation (en microseconde).
+ */
+void charge_debit(double debit, long long duree)
+{
+	int i;
+
+	initialise_entrees(duree);
+	ajoute_periode(0);
+	for (i=0;i<nb_entrees;i++)
+		periodes[0].cumules[i] = debit;
+	cumule_periodes();
+}
+
+/**
+ * \fn void charge_debits(char *chemin, long long duree)
+ * \brief Decrit une charge ouverte a partir d'un fichier de debits (option "-O").
+ *
+ * Chaque ligne du fichier (hors lignes vides et commentaires commencant par '#') est de la forme "seconde carrefour voie debit" :
+ * a partir de la seconde donnee, l'entree (carrefour, voie) recoit le debit donne (en voiture par seconde), jusqu'a une nouvelle ligne pour la meme entree.
+ * Un carrefour ou une voie valant -1 designe toutes les entrees correspondantes ; les dates doivent etre croissantes.
+ * Les entrees sans debit ne recoivent aucune voiture.
+ *
+ * Quitte le programme si le fichier est invalide.
+ *
+ * \param chemin Le chemin du fichier de debits.
+ * \param duree La duree de la generation (en microseconde).
+ */
+void charge_debits(char *chemin, long long duree)
+{
+	FILE *f;
+	char ligne[256];
+	double seconde, debit;
+	long long date;
+	int carrefour, voie, numero = 0, i, trouvees;
+
+	f = fopen(chemin, "r");
+	if (f == NULL)
+		erreurFin("Pb ouverture debits");
+
+	initialise_entrees(duree);
+	ajoute_periode(0);
+
+	while (fgets(ligne, sizeof(ligne), f) != NULL) {
+		numero++;
+		if (ligne[strspn(ligne, " \t")] == '#' || ligne[strspn(ligne, " \t\r\n")] == '\0')
+			continue;
+		if (sscanf(ligne, "%lf %d %d %lf", &seconde, &carrefour, &voie, &debit) != 4 || seconde < 0 || debit < 0
+				|| !(carrefour > 0 && carrefour <= nb_carrefours || carrefour == -1) || !(voie > 0 && voie < 13 || voie == -1)) {
+			printf("Ligne %d invalide dans %s.\n", numero, chemin);
+			exit(-1);
+		}
+
+		date = (long long) (seconde * 1000000);
+		if (date < periodes[nb_periodes-1].debut) {
+			printf("Ligne %d de %s : les dates doivent etre croissantes.\n", numero, chemin);
+			exit(-1);
+		}
+		if (date > periodes[nb_periodes-1].debut)
+			ajoute_periode(date);
+
+		trouvees = 0;
+		for (i=0;i<nb_entrees;i++) {
+			if ((carrefour == -1 || entrees[i].carrefour == carrefour) && (voie == -1 || entrees[i].voie == voie)) {
+				periodes[nb_periodes-1].cumules[i] = debit;
+				trouvees++;
+			}
+		}
+		if (trouvees == 0) {
+			printf("Ligne %d de %s : la voie %d du carrefour %d n'est pas une entree de la carte.\n", numero, chemin, voie, carrefour);
+			exit(-1);
+		}
+	}
+
+	fclose(f);
+	cumule_periodes();
+}
+
+/**
+ * \fn int arrivees_prevues()
+ * \brief Retourne le nombre d'arrivees d'une charge ouverte a prevoir pour les mesures des trajets.
+ *
+ * C'est le nombre moyen d'arrivees (somme des debits par la duree de chaque periode) augmente d'une marge qui couvre les fluctuations du processus de Poisson.
+ */
+int arrivees_prevues()
+{
+	double total = 0;
+	long long fin;
+	int i;
+
+	for (i=0;i<nb_periodes && periodes[i].debut < duree_ouverte;i++) {
+		fin = i+1 < nb_periodes && periodes[i+1].debut < duree_ouverte ? periodes[i+1].debut : duree_ouverte;
+		total += periodes[i].total * (fin - periodes[i].debut) / 1000000.0;
+	}
+
+	total += total/10 + 100;
+	return total < 0x7FFFFFFF ? (int) total : 0x7FFFFFFF;
+}
+
+/**
+ * \fn int prochaine_arrivee(Arrivee *a)
+ * \brief Genere la prochaine arrivee d'une charge ouverte.
+ *
+ * L'ecart entre deux arrivees suit une loi exponentielle de parametre le debit total de la periode, et l'entree est tiree au prorata des debits (superposition des processus de Poisson des entrees).
+ * Une arrivee tiree au-dela de la fin de sa periode est abandonnee et le tirage reprend a la periode suivante (le processus est sans memoire).
+ * Les arrivees ne dependent que de la graine globale. A appeler depuis un seul thread.
+ *
+ * \param a Pointeur sur l'arrivee qui va etre renseignee (date depuis le debut de la simulation).
+ *
+ * \return 1 si une arrivee a ete generee, 0 si la duree de la generation est ecoulee.
+ */
+int prochaine_arrivee(Arrivee *a)
+{
+	PeriodeCharge *p;
+	long long fin, date;
+	double x;
+	int debut, milieu, fin_recherche;
+
+	while (1) {
+		if (date_ouverte >= duree_ouverte)
+			return 0;
+
+		p = &periodes[periode_courante];
+		fin = periode_courante+1 < nb_periodes ? periodes[periode_courante+1].debut : duree_ouverte;
+		if (fin > duree_ouverte)
+			fin = duree_ouverte;
+
+		date = fin;
+		if (p->total > 0)
+			date = date_ouverte + (long long) (-log((alea(&alea_ouverte) + 1.0) / 4294967296.0) / p->total * 1000000);
+		if (date < fin)
+			break;
+
+		date_ouverte = fin;
+		if (periode_courante+1 < nb_periodes)
+			periode_courante++;
+	}
+
+	x = (alea(&alea_ouverte) + 0.5) / 4294967296.0 * p->total;
+	debut = 0;
+	fin_recherche = nb_entrees-1;
+	while (debut < fin_recherche) {
+		milieu = (debut+fin_recherche) / 2;
+		if (p->cumules[milieu] > x)
+			fin_recherche = milieu;
+		else
+			debut = milieu+1;
+	}
+
+	date_ouverte = date;
+	a->date = date;
+	a->voie = entrees[debut].voie;
+	a->carrefour = entrees[debut].carrefour;
+	return 1;
+}
+
+/**
+ * \fn int entree_voiture(EtatVoiture *voitures, Arrivee *a)
+ * \brief Fait entrer sur la carte la voiture d'une arrivee d'une charge ouverte, sous un numero libre.
+ *
+ * Le flux aleatoire de la voiture est derive du rang de l'arrivee et non de son numero : deux trajets sous le meme numero ne font pas les memes tirages.
+ * La date d'arrivee de la voiture reste a renseigner par l'appelant.
+ *
+ * \param voitures Les etats des voitures (indices par leur numero).
+ * \param a Pointeur sur l'arrivee.
+ *
+ * \return Le numero de la voiture, -1 si aucun numero n'est libre (l'arrivee est refusee).
+ */
+int entree_voiture(EtatVoiture *voitures, Arrivee *a)
+{
+	long long rang;
+	int numero;
+
+	pthread_mutex_lock(&verrou_ouverte);
+	rang = arrivees_offertes++;
+	if (nb_libres == 0) {
+		arrivees_refusees++;
+		pthread_mutex_unlock(&verrou_ouverte);
+		return -1;
+	}
+	numero = numeros_libres[--nb_libres];
+	if (++charge_en_route > max_en_route)
+		max_en_route = charge_en_route;
+	pthread_mutex_unlock(&verrou_ouverte);
+
+	initialise_etat(&voitures[numero], numero, a->voie, a->carrefour);
+	initialise_alea(&voitures[numero].alea, (int) rang);
+
+	return numero;
+}
+
+/**
+ * \fn int sortie_voiture(int numero, long long date)
+ * \brief Rend le numero d'une voiture sortie de la carte (charge ouverte).
+ *
+ * \param numero Le numero de la voiture.
+ * \param date La date de sortie depuis le debut de la simulation (en microseconde).
+ *
+ * \return 1 si c'etait la derniere voiture en route et que toutes les arrivees ont ete generees (la simulation est terminee), 0 sinon.
+ */
+int sortie_voiture(int numero, long long date)
+{
+	int fin;
+
+	pthread_mutex_lock(&verrou_ouverte);
+	numeros_libres[nb_libres++] = numero;
+	charge_en_route--;
+	if (date <= duree_ouverte)
+		sorties_fenetre++;
+	fin = generation_finie && charge_en_route == 0;
+	pthread_mutex_unlock(&verrou_ouverte);
+
+	return fin;
+}
+
+/**
+ * \fn int fin_generation()
+ * \brief Signale que toutes les arrivees d'une charge ouverte ont ete generees.
+ *
+ * \return 1 si aucune voiture n'est plus en route (la simulation est terminee), 0 sinon.
+ */
+int fin_generation()
+{
+	int fin;
+
+	pthread_mutex_lock(&verrou_ouverte);
+	generation_finie = 1;
+	fin = charge_en_route == 0;
+	pthread_mutex_unlock(&verrou_ouverte);
+
+	return fin;
+}
+
+/**
+ * \fn void bilan_charge_ouverte()
+ * \brief Ajoute au bilan les arrivees d'une charge ouverte et le debit de sortie pendant la generation.
+ */
+void bilan_charge_ouverte()
+{
+	sprintf(buffer, "Charge ouverte : %lld arrivees sur %d entrees en %.3f s (%.3f voitures/s), %lld refusees (carte saturee)\n",
+			arrivees_offertes, nb_entrees, duree_ouverte/1000000.0, arrivees_offertes * 1000000.0 / duree_ouverte, arrivees_refusees);
+	bilan(buffer);
+	sprintf(buffer, "Debit de sortie pendant la generation : %.3f voitures/s, au plus %d voitures en route sur %d numeros\n",
+			sorties_fenetre * 1000000.0 / duree_ouverte, max_en_route, charge_nombre);
+	bilan(buffer);
+}
@@ -0,0 +1,68 @@
+#ifndef __CHARGE__
+#define __CHARGE__
+
+#include "project.h"
+
+/*! La signature placee en tete des fichiers de charge. */
+#define MAGIQUE_CHARGE "CARCHARG"
+/*! La version du format des fichiers de charge. */
+#define VERSION_CHARGE 1
+
+/**
+ * \struct EnteteCharge
+ * \brief Represente l'entete d'un fichier de charge (24 octets).
+ */
+typedef struct EnteteCharge {
+	char magique[8];	/*!< La signature MAGIQUE_CHARGE. */
+	int version;	/*!< La version du format (VERSION_CHARGE). */
+	int taille;	/*!< La taille d'une arrivee (sizeof(Arrivee)). */
+	long long nombre;	/*!< Le nombre d'arrivees (<=> de voitures). */
+} EnteteCharge;
+
+/**
+ * \struct Arrivee
+ * \brief Represente l'arrivee d'une voiture sur la carte (16 octets).
+ */
+typedef struct Arrivee {
+	long long date;	/*!< La date d'arrivee depuis le debut de la simulation (en microseconde). */
+	int voie;	/*!< Le numero de la voie (-1 pour une voie aleatoire). */
+	int carrefour;	/*!< Le numero du carrefour (-1 pour un carrefour aleatoire). */
+} Arrivee;
+
+/**
+ * \struct PeriodeCharge
+ * \brief Represente une periode de debits constants d'une charge ouverte (options "-o" et "-O").
+ */
+typedef struct PeriodeCharge {
+	long long debut;	/*!< La date de debut de la periode depuis le debut de la simulation (en microseconde). */
+	double total;	/*!< Le debit total de la periode, toutes entrees confondues (en voiture par seconde). */
+	double *cumules;	/*!< Les debits cumules des entrees de la carte (cumules[i] : somme des debits des entrees 0 a i). */
+} PeriodeCharge;
+
+extern int charge_nombre;	/*!< Le nombre de voitures de la simulation (en charge ouverte : le nombre maximal de voitures en route). */
+extern int charge_ouverte;	/*!< Vaut 1 si les voitures arrivent en continu aux entrees de la carte (options "-o" et "-O"), 0 sinon. */
+extern int charge_en_route;	/*!< Le nombre de voitures en route (charge ouverte). */
+
+void charge_arguments(int nbVoitures, char *argv[]);
+
+void charge_fichier(char *chemin);
+
+void arrivee_voiture(int i, Arrivee *a);
+
+void charge_debit(double debit, long long duree);
+
+void charge_debits(char *chemin, long long duree);
+
+int arrivees_prevues();
+
+int prochaine_arrivee(Arrivee *a);
+
+int entree_voiture(EtatVoiture *voitures, Arrivee *a);
+
+int sortie_voiture(int numero, long long date);
+
+int fin_generation();
+
+void bilan_charge_ouverte();
+
+#endif
@@ -17,6 +17,7 @@
  * - MESSDEMANDE : demande d'arrivee en zone avant, pendant, ou apres un croisement. Implique une demande au serveur (depuis le carrefour) qui va analyser le carrefour pour prendre une decision.
  * - MESSINFO : message d'information d'arrivee avant, pendant, ou apres un croisement. N'implique aucun traitement, affiche juste l'information.
  * - MESSSORT : message d'information de sortie d'un carrefour. Implique de mettre a jour la file d'attente "apres" le croisement precedent.
+ * - MESSRESERVE : demande de reservation de tous les croisements de la voie (reservation de parcours). Decidee par le carrefour.
  *
  * \param req Pointeur vers la requete qui va etre renseignee.
  * \param v Pointeur vers la voiture effectuant la requete.
@@ -42,7 +43,7 @@
 void constructionRequete(Requete *req, Voiture *v, int carrefour, int croisement_precedent, int croisement_precedent_orientation, int croisement, int croisement_orientation, int voie, int traverse, int type)
 {
 	req->pidEmetteur = getpid();
-	req->v = *v;
+	req->voiture = v->numero;
 	req->carrefour = carrefour;
 	req->croisement = croisement;
 	req->croisement_orientation = croisement_orientation;
@@ -51,6 +52,7 @@ void constructionRequete(Requete *req, Voiture *v, int carrefour, int croisement
 	req->voie = voie;
 	req->traverse = traverse;
 	req->type = type;
+	req->ticket = -1;
 }
 
 /**
@@ -62,9 +64,9 @@ void constructionRequete(Requete *req, Voiture *v, int carrefour, int croisement
 void affichageRequete(Requete *req)
 {
 	if (req->type == MESSARRIVE) {
-		message(req->v.numero, "---------------------\n");
+		message(req->voiture, "---------------------\n");
 		sprintf(buffer, "Arrive carrefour %d\n\n", req->carrefour);
-		message(req->v.numero, buffer);
+		message(req->voiture, buffer);
 		sprintf(buffer, "Arrive voie %d\n\n", req->voie);
 	} else if (req->type == MESSDEMANDE) {
 		if (req->traverse == AVANT) sprintf(buffer, "Dem. av. voie %d\n", req->voie);
@@ -75,14 +77,37 @@ void affichageRequete(Requete *req)
 		else if (req->traverse == PENDANT) sprintf(buffer, "Trav. voie %d\n", req->voie);
 		else if (req->traverse == APRES) sprintf(buffer, "Arrive ap. voie %d\n", req->voie);
 	} else if (req->type == MESSSORT) {
-		message(req->v.numero, "\n");
+		message(req->voiture, "\n");
 		sprintf(buffer, "Sort voie %d\n\n", req->voie);
-		message(req->v.numero, buffer);
+		message(req->voiture, buffer);
 		sprintf(buffer, "Sort carrefour %d\n", req->carrefour);
-		message(req->v.numero, buffer);
-		message(req->v.numero, "---------------------\n");
+		message(req->voiture, buffer);
+		message(req->voiture, "---------------------\n");
 		sprintf(buffer, "#####################\n");
+	} else if (req->type == MESSRESERVE) {
+		sprintf(buffer, "Dem. parcours voie %d\n", req->voie);
 	}
 
-	message(req->v.numero, buffer);
+	message(req->voiture, buffer);
+}
+
+/**
+ * \fn void affichageAutorisation(Requete *req, int autorisation)
+ * \brief Affiche la decision prise sur une demande (ou une reservation de parcours), dans la colonne de la voiture.
+ *
+ * Utilise par affichageReponse() pendant la simulation et par le programme rendu a la relecture d'une trace.
+ *
+ * \param req Pointeur sur la demande.
+ * \param autorisation La decision : 1 si la demande est autorisee, 0 si elle est interdite.
+ */
+void affichageAutorisation(Requete *req, int autorisation)
+{
+	char *decision = autorisation == 1 ? "Aut." : "Int.";
+
+	if (req->type == MESSRESERVE) sprintf(buffer, "   %s parcours voie %d\n", decision, req->voie);
+	else if (req->traverse == AVANT) sprintf(buffer, "   %s av. voie %d\n", decision, req->voie);
+	else if (req->traverse == PENDANT) sprintf(buffer, "   %s trav. voie %d\n", decision, req->voie);
+	else sprintf(buffer, "   %s ap. voie %d\n", decision, req->voie);
+
+	message(req->voiture, buffer);
 }
@@ -5,4 +5,6 @@ void constructionRequete(Requete *req, Voiture *v, int carrefour, int croisement
 
 void affichageRequete(Requete *req);
 
+void affichageAutorisation(Requete *req, int autorisation);
+
 #endif
@@ -0,0 +1,255 @@
+/**
+ * \file feux.c
+ * \brief Contient le controleur de feux des carrefours (option "-c").
+ *
+ * Les voies d'un carrefour sont regroupees en phases : deux voies d'une meme phase ne passent par aucun croisement commun, et peuvent donc circuler en meme temps sans jamais se gener.
+ * A chaque instant, une seule phase de chaque carrefour est verte. La ligne d'arret d'une voie est la file avant de son premier croisement : une voiture n'y traverse ce croisement que si la phase de sa voie est verte. Une fois engagee, elle termine sa voie sans consulter le feu.
+ *
+ * Le feu s'adapte aux files du carrefour (compteurs avantH / avantV du segment partage, voir avance_feu()) :
+ * - une phase reste verte au moins VERT_MIN, sauf si plus aucune voiture n'occupe ses voies ;
+ * - elle le reste ensuite tant que ses lignes d'arret ont des voitures, d'autant plus longtemps que ses voies sont chargees (VERT_PAR_VOITURE par voiture en attente), sans depasser VERT_MAX si d'autres phases attendent ;
+ * - elle passe ensuite a la phase suivante qui a des voitures arretees, et reste verte si aucune n'en a.
+ *
+ * Entre deux phases, le feu est rouge pour toutes les voies (degagement) jusqu'a ce que les voitures engagees sur d'autres voies aient passe tous les croisements de la nouvelle phase (voir voitures_engagees()).
+ * Deux voitures engagees sur des voies differentes n'ont alors plus aucun croisement commun a passer : chacune n'attend que des places de sa propre voie, et aucun interblocage ne peut se former.
+ * Cette garantie est exacte lorsqu'un seul processus decide pour le carrefour (moteur a evenements discrets, ADMISSION_LOCALE) ; ailleurs, une voiture peut passer sa ligne d'arret pendant que le feu change.
+ *
+ * L'etat du feu tient dans un seul mot du carrefour (phase, degagement et date de debut, voir MOT_FEU()) : n'importe quel processus ou thread peut le faire avancer par compare-and-swap.
+ *
+ * Le feu ne reduit pas le nombre de messages ni de decisions : chaque voiture demande toujours sa ligne d'arret, et la phase verte n'est pas accordee en une seule decision a toute sa file.
+ * Avec les moteurs "-t" et "-d", une voiture arretee au rouge redemande toutes les MINPAUSE, comme apres tout refus ; seul le processus carrefour garde les demandes arretees et les reveille au changement de phase.
+ * Les feux echangent donc du debit contre l'absence d'interblocage (60 voitures "-t" : 47 s au lieu de 37 ; 200 voitures "-d" : 80 s de temps virtuel et 3,8 millions d'evenements au lieu de 61 s et 0,6 million).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "project.h"
+#include "voiture.h"
+#include "moteur.h"
+#include "simulation.h"
+#include "statistiques.h"
+#include "interblocage.h"
+#include "feux.h"
+
+/*! Le nombre de phases des feux, calcule par initialise_feux() (identique pour tous les carrefours). */
+int nb_phases = 0;
+/*! La phase de chaque voie (voie v : indice v-1), -1 pour une voie qui ne croise aucune autre voie. */
+int phase_voie[12];
+/*! Les croisements de chaque phase : l'union des masques de ses voies (voir masque_parcours()). */
+unsigned int masques_phases[12];
+
+/**
+ * \fn void initialise_feux()
+ * \brief Regroupe les voies en phases : chaque voie rejoint la premiere phase dont elle ne croise aucune voie.
+ */
+void initialise_feux()
+{
+	unsigned int masque;
+	int v, p;
+
+	nb_phases = 0;
+	for (p=0;p<12;p++)
+		masques_phases[p] = 0;
+	for (v=0;v<12;v++) {
+		phase_voie[v] = -1;
+		masque = masque_parcours(v+1);
+		if (masque == 0)
+			continue;
+
+		for (p=0;p<nb_phases && (masques_phases[p] & masque) != 0;p++);
+		if (p == nb_phases)
+			nb_phases++;
+		masques_phases[p] |= masque;
+		phase_voie[v] = p;
+	}
+}
+
+/**
+ * \fn long long date_feux()
+ * \brief Retourne la date courante des feux : la date virtuelle avec le moteur a evenements discrets, l'horloge monotone sinon.
+ */
+long long date_feux()
+{
+	return moteur == MOTEUR_EVENEMENTS ? date_virtuelle : maintenant();
+}
+
+/**
+ * \fn int voitures_phase(Carrefour *c, int phase, int *arretees)
+ * \brief Compte les voitures en attente dans les files avant des voies d'une phase, lues sans verrou.
+ *
+ * \param c Pointeur sur le carrefour.
+ * \param phase La phase.
+ * \param arretees Pointeur sur le nombre de ces voitures qui sont sur une ligne d'arret (file avant du premier croisement).
+ *
+ * \return Le nombre de voitures en attente sur les voies de la phase.
+ */
+int voitures_phase(Carrefour *c, int phase, int *arretees)
+{
+	Passage *p;
+	Croisement *x;
+	int v, j, n, voitures = 0;
+
+	*arretees = 0;
+	for (v=0;v<12;v++) {
+		if (phase_voie[v] != phase)
+			continue;
+
+		for (j=0;j<voies[v].nombre;j++) {
+			p = &passages[voies[v].premier + j];
+			x = &c->croisements[p->croisement];
+			n = __atomic_load_n(p->orientation == HO ? &x->avantH : &x->avantV, __ATOMIC_RELAXED);
+			voitures += n;
+			if (j == 0)
+				*arretees += n;
+		}
+	}
+
+	return voitures;
+}
+
+/**
+ * \fn int phase_vide(Carrefour *c, int phase)
+ * \brief Indique si aucune voiture n'occupe les voies d'une phase (files avant, croisements et files apres), lues sans verrou.
+ *
+ * \param c Pointeur sur le carrefour.
+ * \param phase La phase.
+ *
+ * \return 1 si les voies de la phase sont vides, 0 sinon.
+ */
+int phase_vide(Carrefour *c, int phase)
+{
+	Passage *p;
+	Croisement *x;
+	int v, j;
+
+	for (v=0;v<12;v++) {
+		if (phase_voie[v] != phase)
+			continue;
+
+		for (j=0;j<voies[v].nombre;j++) {
+			p = &passages[voies[v].premier + j];
+			x = &c->croisements[p->croisement];
+			if (__atomic_load_n(p->orientation == HO ? &x->avantH : &x->avantV, __ATOMIC_RELAXED) > 0
+					|| __atomic_load_n(p->orientation == HO ? &x->apresH : &x->apresV, __ATOMIC_RELAXED) > 0
+					|| (__atomic_load_n(&x->etat, __ATOMIC_RELAXED) == 1 && __atomic_load_n(&x->occupant, __ATOMIC_RELAXED) == p->orientation))
+				return 0;
+		}
+	}
+
+	return 1;
+}
+
+/**
+ * \fn int voitures_engagees(Carrefour *c, int phase)
+ * \brief Compte les voitures engagees (au dela de leur ligne d'arret) qui doivent encore passer par un croisement d'une phase, lues sans verrou.
+ *
+ * Une voiture d'une autre phase qui a deja passe tous les croisements qu'elle partage avec la phase ne la gene plus, meme si elle n'a pas quitte le carrefour.
+ *
+ * \param c Pointeur sur le carrefour.
+ * \param phase La phase.
+ *
+ * \return Le nombre de voitures qui doivent degager avant que la phase puisse passer au vert.
+ */
+int voitures_engagees(Carrefour *c, int phase)
+{
+	Passage *p;
+	Croisement *x;
+	unsigned int restant;
+	int v, j, voitures = 0;
+
+	for (v=0;v<12;v++) {
+		if (phase_voie[v] == -1 || phase_voie[v] == phase)
+			continue;
+
+		restant = 0;
+		for (j=voies[v].nombre-1;j>=0;j--) {
+			p = &passages[voies[v].premier + j];
+			x = &c->croisements[p->croisement];
+			if ((restant & masques_phases[phase]) != 0)
+				voitures += __atomic_load_n(p->orientation == HO ? &x->apresH : &x->apresV, __ATOMIC_RELAXED);
+
+			restant |= 1U << p->croisement;
+			if ((restant & masques_phases[phase]) == 0)
+				continue;
+			if (__atomic_load_n(&x->etat, __ATOMIC_RELAXED) == 1 && __atomic_load_n(&x->occupant, __ATOMIC_RELAXED) == p->orientation)
+				voitures++;
+			if (j > 0)
+				voitures += __atomic_load_n(p->orientation == HO ? &x->avantH : &x->avantV, __ATOMIC_RELAXED);
+		}
+	}
+
+	return voitures;
+}
+
+/**
+ * \fn int avance_feu(Carrefour *c, long long date)
+ * \brief Fait avancer le feu d'un carrefour : fin de la phase verte, puis fin du degagement.
+ *
+ * La phase verte est conservee pendant VERT_MIN (sauf si ses voies sont vides, voir phase_vide()), puis tant que ses lignes d'arret ont des voitures et que sa duree n'atteint ni VERT_MIN + VERT_PAR_VOITURE par voiture en attente sur ses voies, ni VERT_MAX.
+ * Elle est aussi conservee si aucune autre phase n'a de voiture arretee.
+ * Le feu passe sinon en degagement vers la phase suivante qui a des voitures arretees, puis au vert des que plus aucune voiture engagee ne doit passer par ses croisements (voitures_engagees()).
+ *
+ * \param c Pointeur sur le carrefour (segment de memoire partagee).
+ * \param date La date courante (voir date_feux()).
+ *
+ * \return 1 si une nouvelle phase est passee au vert, 0 sinon.
+ */
+int avance_feu(Carrefour *c, long long date)
+{
+	unsigned long long feu = __atomic_load_n(&c->feu, __ATOMIC_ACQUIRE);
+	int phase = PHASE_FEU(feu), suivante = -1, voitures, arretees, k, n;
+	long long duree = date - DEBUT_FEU(feu);
+
+	if (DEGAGEMENT_FEU(feu) == 0) {
+		for (k=1;k<nb_phases && suivante == -1;k++) {
+			voitures_phase(c, (phase+k) % nb_phases, &n);
+			if (n > 0)
+				suivante = (phase+k) % nb_phases;
+		}
+		if (suivante == -1)
+			return 0;
+
+		voitures = voitures_phase(c, phase, &arretees);
+		if ((duree < VERT_MIN && phase_vide(c, phase) == 0) || (arretees > 0 && duree < VERT_MIN + voitures * VERT_PAR_VOITURE && duree < VERT_MAX))
+			return 0;
+
+		if (!__atomic_compare_exchange_n(&c->feu, &feu, MOT_FEU(suivante, 1, date), 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+			return 0;
+		feu = MOT_FEU(suivante, 1, date);
+		phase = suivante;
+	}
+
+	if (voitures_engagees(c, phase) > 0)
+		return 0;
+
+	if (!__atomic_compare_exchange_n(&c->feu, &feu, MOT_FEU(phase, 0, date), 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+		return 0;
+
+	stats_phase();
+	return 1;
+}
+
+/**
+ * \fn int feu_vert(Carrefour *c, Requete *req)
+ * \brief Indique si une demande passe le feu : seules les traversees depuis une ligne d'arret sont soumises a la phase verte.
+ *
+ * Le feu est d'abord avance si necessaire (avance_feu()).
+ *
+ * \param c Pointeur sur le carrefour.
+ * \param req Pointeur sur la demande.
+ *
+ * \return 1 si la demande peut etre examinee, 0 si la voie de la voiture est au rouge (ou le feu en degagement).
+ */
+int feu_vert(Carrefour *c, Requete *req)
+{
+	unsigned long long feu;
+	int v;
+
+	if (req->type != MESSDEMANDE || req->traverse != PENDANT || req->croisement_precedent != -1)
+		return 1;
+
+	v = voie_croisement[req->croisement][req->croisement_orientation];
+	avance_feu(c, date_feux());
+
+	feu = __atomic_load_n(&c->feu, __ATOMIC_ACQUIRE);
+	return DEGAGEMENT_FEU(feu) == 0 && PHASE_FEU(feu) == phase_voie[v];
+}
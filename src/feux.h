@@ -0,0 +1,46 @@
+#ifndef __FEUX__
+#define __FEUX__
+
+#include "project.h"
+
+/*! La duree minimale d'une phase verte, en microseconde. Redefinissable a la compilation (-DVERT_MIN=...). */
+#ifndef VERT_MIN
+#define VERT_MIN (10LL*MAXPAUSE)
+#endif
+/*! Le temps vert ajoute a une phase par voiture en attente sur ses voies, en microseconde. Redefinissable a la compilation (-DVERT_PAR_VOITURE=...). */
+#ifndef VERT_PAR_VOITURE
+#define VERT_PAR_VOITURE (5LL*MAXPAUSE)
+#endif
+/*! La duree maximale d'une phase verte lorsque d'autres phases ont des voitures arretees, en microseconde. Redefinissable a la compilation (-DVERT_MAX=...). */
+#ifndef VERT_MAX
+#define VERT_MAX (100LL*MAXPAUSE)
+#endif
+
+/*! La phase d'un feu (voir Carrefour) : la phase verte, ou la phase qui attend la fin du degagement. */
+#define PHASE_FEU(feu) ((int) ((feu) & 0xF))
+/*! Vaut 1 si le feu est en degagement (rouge pour toutes les voies), 0 si sa phase est verte. */
+#define DEGAGEMENT_FEU(feu) ((int) (((feu) >> 4) & 1))
+/*! La date de debut de la phase ou du degagement d'un feu (en microseconde). */
+#define DEBUT_FEU(feu) ((long long) ((feu) >> 5))
+/*! Le mot d'un feu : une phase, l'indicateur de degagement et la date de debut. */
+#define MOT_FEU(phase, degagement, date) (((unsigned long long) (date) << 5) | ((degagement) << 4) | (phase))
+
+extern int nb_phases;	/*!< Le nombre de phases des feux (identique pour tous les carrefours). */
+extern int phase_voie[12];	/*!< La phase de chaque voie (-1 pour une voie qui ne croise aucune autre voie). */
+extern unsigned int masques_phases[12];	/*!< Les croisements de chaque phase (voir masque_parcours()). */
+
+void initialise_feux();
+
+long long date_feux();
+
+int voitures_phase(Carrefour *c, int phase, int *arretees);
+
+int phase_vide(Carrefour *c, int phase);
+
+int voitures_engagees(Carrefour *c, int phase);
+
+int avance_feu(Carrefour *c, long long date);
+
+int feu_vert(Carrefour *c, Requete *req);
+
+#endif
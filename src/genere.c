@@ -0,0 +1,110 @@
+/**
+ * \file genere.c
+ * \brief Programme annexe : cree un fichier de charge (option "-w" du projet).
+ *
+ * Syntaxe :
+ * - "./genere fichier NbVoitures Duree Graine" : NbVoitures voitures aux voies et carrefours aleatoires, arrivant a des dates tirees uniformement dans [0, Duree[ (en microseconde).
+ * - "./genere fichier" : convertit les lignes "date voie carrefour" lues sur l'entree standard (-1 pour une voie ou un carrefour aleatoire).
+ *
+ * Les arrivees sont ecrites triees par date.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "project.h"
+#include "alea.h"
+#include "charge.h"
+
+int compare_arrivees(const void *a, const void *b);
+
+/**
+ * \fn int main(int argc, char* argv[])
+ * \brief Construit les arrivees (aleatoires ou lues sur l'entree standard), les trie et ecrit le fichier de charge.
+ */
+int main(int argc, char* argv[])
+{
+	EnteteCharge entete;
+	Arrivee *arrivees;
+	Alea a;
+	FILE *f;
+	long long i, nombre = 0, capacite = 1024, duree;
+
+	if (argc != 2 && argc != 5) {
+		printf("Syntaxe : ""./genere fichier NbVoitures Duree Graine"" OU ""./genere fichier < arrivees.txt"".\n");
+		exit(-1);
+	}
+
+	if (argc == 5) {
+		capacite = atoll(argv[2]);
+		duree = atoll(argv[3]);
+		graine_globale = strtoull(argv[4], NULL, 10);
+		if (capacite <= 0 || capacite > 0x7FFFFFFF || duree <= 0) {
+			printf("Veuillez entrer un nombre de voitures et une duree superieurs a 0.\n");
+			exit(-1);
+		}
+	}
+
+	arrivees = malloc(capacite * sizeof(Arrivee));
+	if (arrivees == NULL) {
+		perror("Pb malloc");
+		exit(1);
+	}
+
+	if (argc == 5) {
+		initialise_alea(&a, -1);
+		for (nombre=0;nombre<capacite;nombre++) {
+			arrivees[nombre].date = (((unsigned long long) alea(&a) << 32) | alea(&a)) % duree;
+			arrivees[nombre].voie = -1;
+			arrivees[nombre].carrefour = -1;
+		}
+	} else {
+		while (scanf("%lld %d %d", &arrivees[nombre].date, &arrivees[nombre].voie, &arrivees[nombre].carrefour) == 3) {
+			if (arrivees[nombre].date < 0 || !(arrivees[nombre].voie > 0 && arrivees[nombre].voie < 13 || arrivees[nombre].voie == -1)
+					|| !(arrivees[nombre].carrefour > 0 || arrivees[nombre].carrefour == -1)) {
+				printf("Ligne %lld invalide : date positive, voie entre 1 et 12, carrefour positif (ou -1) attendus.\n", nombre+1);
+				exit(-1);
+			}
+			if (++nombre == capacite) {
+				capacite *= 2;
+				arrivees = realloc(arrivees, capacite * sizeof(Arrivee));
+				if (arrivees == NULL) {
+					perror("Pb realloc");
+					exit(1);
+				}
+			}
+		}
+		if (nombre == 0) {
+			printf("Aucune arrivee lue.\n");
+			exit(-1);
+		}
+	}
+
+	qsort(arrivees, nombre, sizeof(Arrivee), compare_arrivees);
+
+	memset(&entete, 0, sizeof(entete));
+	memcpy(entete.magique, MAGIQUE_CHARGE, 8);
+	entete.version = VERSION_CHARGE;
+	entete.taille = sizeof(Arrivee);
+	entete.nombre = nombre;
+
+	f = fopen(argv[1], "wb");
+	if (f == NULL || fwrite(&entete, sizeof(entete), 1, f) != 1 || fwrite(arrivees, sizeof(Arrivee), nombre, f) != nombre || fclose(f) != 0) {
+		perror("Pb ecriture charge");
+		exit(1);
+	}
+
+	printf("%lld arrivees ecrites dans %s.\n", nombre, argv[1]);
+	free(arrivees);
+	return 0;
+}
+
+/**
+ * \fn int compare_arrivees(const void *a, const void *b)
+ * \brief Compare deux arrivees selon leur date (pour qsort).
+ */
+int compare_arrivees(const void *a, const void *b)
+{
+	long long da = ((Arrivee *) a)->date, db = ((Arrivee *) b)->date;
+
+	return (da > db) - (da < db);
+}
@@ -0,0 +1,190 @@
+/**
+ * \file interblocage.c
+ * \brief Contient la detection des interblocages dans un carrefour et la politique d'admission qui les evite (option "-e").
+ *
+ * Une voiture engagee sur un carrefour occupe exactement une case : la file avant, le croisement lui meme, ou la file apres d'un croisement de sa voie.
+ * Une case pleine ne se libere que lorsqu'une de ses voitures avance dans la case suivante de sa voie. Le graphe d'attente entre cases est donc une fonction : chaque case a une seule suivante, celle d'un croisement dependant de l'orientation de la voiture qui le traverse.
+ * Un cycle de cases pleines est un interblocage : aucune de ses voitures ne pourra plus avancer. Il est detecte par la demande qui le ferme (detecte_interblocage()).
+ *
+ * L'evitement applique l'algorithme du banquier (etat_sur()) : une demande n'est accordee que si, une fois appliquee, les voitures du carrefour peuvent toutes sortir l'une apres l'autre, chacune parcourant seule la fin de sa voie.
+ * Dans un tel etat, la premiere voiture de cet ordre peut toujours avancer et ses demandes restent accordees : le carrefour ne se bloque jamais.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "project.h"
+#include "voiture.h"
+#include "statistiques.h"
+#include "interblocage.h"
+
+/*! La voie (0 a 11) qui passe sur chaque croisement dans chaque orientation, -1 si aucune. */
+int voie_croisement[25][2];
+/*! Le rang du passage de cette voie sur le croisement (0 pour son premier croisement). */
+int rang_croisement[25][2];
+/*! Les cases successives de chaque voie (3 par croisement : file avant, croisement, file apres), numerotees par CASE_CROISEMENT(). */
+int cases_voies[12][3*6];
+
+/**
+ * \fn void initialise_interblocage()
+ * \brief Construit, a partir des voies, les tables qui relient les cases des carrefours aux voies.
+ */
+void initialise_interblocage()
+{
+	Passage *p;
+	int i, o, v, j;
+
+	for (i=0;i<25;i++)
+		for (o=0;o<2;o++)
+			voie_croisement[i][o] = -1;
+
+	for (v=0;v<12;v++) {
+		for (j=0;j<voies[v].nombre;j++) {
+			p = &passages[voies[v].premier + j];
+			voie_croisement[p->croisement][p->orientation] = v;
+			rang_croisement[p->croisement][p->orientation] = j;
+			cases_voies[v][3*j] = CASE_CROISEMENT(p->croisement, p->orientation == HO ? CASE_AVANTH : CASE_AVANTV);
+			cases_voies[v][3*j+1] = CASE_CROISEMENT(p->croisement, CASE_ETAT);
+			cases_voies[v][3*j+2] = CASE_CROISEMENT(p->croisement, p->orientation == HO ? CASE_APRESH : CASE_APRESV);
+		}
+	}
+}
+
+/**
+ * \fn int place_case(Carrefour *c, int id)
+ * \brief Retourne le nombre de places libres d'une case.
+ *
+ * \param c Pointeur sur le carrefour.
+ * \param id Le numero de la case (voir CASE_CROISEMENT()).
+ */
+int place_case(Carrefour *c, int id)
+{
+	Croisement *x = &c->croisements[id / NB_CASES_CROISEMENT];
+
+	switch (id % NB_CASES_CROISEMENT) {
+		case CASE_AVANTH: return MAXFILE - x->avantH;
+		case CASE_AVANTV: return MAXFILE - x->avantV;
+		case CASE_APRESH: return MAXFILE - x->apresH;
+		case CASE_APRESV: return MAXFILE - x->apresV;
+	}
+	return x->etat == 0 ? 1 : 0;
+}
+
+/**
+ * \fn int case_requete(Requete *req)
+ * \brief Retourne la case de son croisement visee par une demande.
+ *
+ * \param req Pointeur sur la demande (MESSDEMANDE).
+ *
+ * \return La case (CASE_AVANTH a CASE_APRESV) dans le croisement demande.
+ */
+int case_requete(Requete *req)
+{
+	if (req->traverse == PENDANT)
+		return CASE_ETAT;
+	if (req->traverse == AVANT)
+		return req->croisement_orientation == HO ? CASE_AVANTH : CASE_AVANTV;
+	return req->croisement_orientation == HO ? CASE_APRESH : CASE_APRESV;
+}
+
+/**
+ * \fn int etat_sur(Carrefour *c, Requete *req)
+ * \brief Indique si le carrefour reste dans un etat sur une fois la demande appliquee (algorithme du banquier).
+ *
+ * L'etat est sur si toutes les voitures du carrefour peuvent sortir l'une apres l'autre : a chaque tour, la voiture de tete d'une voie sort si toutes les cases restantes de sa voie ont une place libre, et libere alors sa case.
+ * Seule la voiture de tete de chaque voie est examinee : les suivantes ont besoin de sa case.
+ * L'appelant doit garantir l'acces exclusif au carrefour.
+ *
+ * \param c Pointeur sur le carrefour.
+ * \param req Pointeur sur la demande (MESSDEMANDE), supposee possible (place libre dans la case demandee).
+ *
+ * \return 1 si l'etat est sur, 0 sinon.
+ */
+int etat_sur(Carrefour *c, Requete *req)
+{
+	int libres[NB_CASES];
+	int voitures[12][3*6] = {{0}};
+	int i, o, v, j, p, q, n, restantes = 0, progres;
+	Croisement *x;
+
+	for (i=0;i<NB_CASES;i++)
+		libres[i] = place_case(c, i);
+
+	for (i=0;i<25;i++) {
+		x = &c->croisements[i];
+		for (o=0;o<2;o++) {
+			v = voie_croisement[i][o];
+			if (v == -1)
+				continue;
+			j = rang_croisement[i][o];
+			voitures[v][3*j] = o == HO ? x->avantH : x->avantV;
+			voitures[v][3*j+1] = (x->etat == 1 && x->occupant == o) ? 1 : 0;
+			voitures[v][3*j+2] = o == HO ? x->apresH : x->apresV;
+			restantes += voitures[v][3*j] + voitures[v][3*j+1] + voitures[v][3*j+2];
+		}
+	}
+
+	v = voie_croisement[req->croisement][req->croisement_orientation];
+	p = 3*rang_croisement[req->croisement][req->croisement_orientation] + req->traverse - AVANT;
+	voitures[v][p]++;
+	libres[cases_voies[v][p]]--;
+	if (p > 0) {
+		voitures[v][p-1]--;
+		libres[cases_voies[v][p-1]]++;
+	} else {
+		restantes++;
+	}
+
+	do {
+		progres = 0;
+		for (v=0;v<12;v++) {
+			n = 3*voies[v].nombre;
+			for (p=n-1;p>=0 && voitures[v][p]==0;p--);
+			if (p < 0)
+				continue;
+			for (q=p+1;q<n && libres[cases_voies[v][q]]>0;q++);
+			if (q < n)
+				continue;
+
+			voitures[v][p]--;
+			libres[cases_voies[v][p]]++;
+			restantes--;
+			progres = 1;
+		}
+	} while (progres == 1 && restantes > 0);
+
+	return restantes == 0;
+}
+
+/**
+ * \fn void detecte_interblocage(Carrefour *c, Requete *req)
+ * \brief Cherche un cycle de cases pleines passant par la case qui vient d'etre accordee a une demande, et le compte dans les statistiques.
+ *
+ * Un interblocage ne peut se former que lorsqu'une case se remplit : il est ainsi compte une seule fois, par la demande qui le ferme.
+ *
+ * \param c Pointeur sur le carrefour, apres application de la demande.
+ * \param req Pointeur sur la demande accordee (MESSDEMANDE).
+ */
+void detecte_interblocage(Carrefour *c, Requete *req)
+{
+	int v = voie_croisement[req->croisement][req->croisement_orientation];
+	int p = 3*rang_croisement[req->croisement][req->croisement_orientation] + req->traverse - AVANT;
+	int depart = cases_voies[v][p], id = depart, i, k;
+
+	for (k=0;k<NB_CASES;k++) {
+		if (place_case(c, id) > 0)
+			return;
+
+		if (id % NB_CASES_CROISEMENT == CASE_ETAT) {
+			i = id / NB_CASES_CROISEMENT;
+			v = voie_croisement[i][c->croisements[i].occupant];
+			p = 3*rang_croisement[i][c->croisements[i].occupant] + 1;
+		}
+		if (++p == 3*voies[v].nombre)
+			return;
+
+		id = cases_voies[v][p];
+		if (id == depart) {
+			stats_interblocage();
+			return;
+		}
+	}
+}
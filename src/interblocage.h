@@ -0,0 +1,35 @@
+#ifndef __INTERBLOCAGE__
+#define __INTERBLOCAGE__
+
+#include "project.h"
+
+/*! Le nombre de cases d'un croisement : ses files avant et apres dans chaque orientation, et le croisement lui meme. */
+#define NB_CASES_CROISEMENT 5
+/*! La case de la file avant horizontale d'un croisement. */
+#define CASE_AVANTH 0
+/*! La case de la file avant verticale d'un croisement. */
+#define CASE_AVANTV 1
+/*! La case du croisement lui meme (partagee par ses deux voies). */
+#define CASE_ETAT 2
+/*! La case de la file apres horizontale d'un croisement. */
+#define CASE_APRESH 3
+/*! La case de la file apres verticale d'un croisement. */
+#define CASE_APRESV 4
+/*! Le nombre de cases d'un carrefour. */
+#define NB_CASES (25*NB_CASES_CROISEMENT)
+/*! Le numero de la case k (CASE_AVANTH a CASE_APRESV) du croisement i. */
+#define CASE_CROISEMENT(i, k) ((i)*NB_CASES_CROISEMENT + (k))
+
+extern int voie_croisement[25][2];	/*!< La voie (0 a 11) qui passe sur chaque croisement dans chaque orientation, -1 si aucune. */
+
+void initialise_interblocage();
+
+int place_case(Carrefour *c, int id);
+
+int case_requete(Requete *req);
+
+int etat_sur(Carrefour *c, Requete *req);
+
+void detecte_interblocage(Carrefour *c, Requete *req);
+
+#endif
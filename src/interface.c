@@ -1,35 +1,237 @@
 /**
  * \file interface.c
  * \brief Affiche les informations a l'ecran et dans un fichier texte.
+ *
+ * Les messages ne sont pas ecrits par les processus qui les emettent : ils sont deposes sans verrou dans un anneau en memoire partagee (le journal).
+ * Un processus ecrivain dedie vide l'anneau et ecrit les messages par lots dans la console et dans output.txt.
  */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/wait.h>
 #include "interface.h"
 
 #define COLONNE 20
 
+/*! La taille du tampon d'ecriture de l'ecrivain. */
+#define TAILLE_LOT 65536
+
+char buffer[1024];
+char output[10240];
+FILE *file;
+
+int journal = -1;
+int silencieux = 0;
+
+/*! L'anneau du journal, attache par chaque processus. */
+Journal *anneau;
+
 /**
  * \fn void message(int i, char* s)
  * \brief Affiche un message dans la console et l'ecrit dans un fichier texte.
  *
  * Affiche les informations de maniere decalee sous forme de colonne pour une meilleure lisibilite.
  * Ecrit a la fois dans la console et dans un fichier texte (pour etude appronfondie et lorsque les colonnes depassent la largeur de la console).
+ * Le message est seulement depose dans le journal : l'appelant n'attend pas l'ecriture et n'a besoin d'aucun verrou.
+ * Ignore en mode silencieux.
  *
  * \param i L'indice de la colonne. Permet de decaler le texte horizontalement.
  * \param s Le message a afficher.
  */
 void message(int i, char* s)
 {
-	int j, NbBlanc;
-	file = fopen("./output.txt", "a");
-	NbBlanc=i*COLONNE;
-	for (j=0; j<NbBlanc; j++) {
-		putchar(' ');
-		fprintf(file, " ");
+	if (silencieux)
+		return;
+
+	depose_enregistrement(i, s);
+}
+
+/**
+ * \fn void bilan(char* s)
+ * \brief Affiche une information de bilan de la simulation (sans decalage), y compris en mode silencieux.
+ *
+ * \param s Le message a afficher.
+ */
+void bilan(char* s)
+{
+	depose_enregistrement(0, s);
+}
+
+/**
+ * \fn void depose_enregistrement(int colonne, char* s)
+ * \brief Depose un message dans l'anneau du journal (decoupe en plusieurs enregistrements s'il est trop long).
+ *
+ * Chaque case est reservee par compare-and-swap sur la position d'ecriture, remplie, puis publiee en mettant a jour son numero de sequence.
+ * Si l'anneau est plein, l'emetteur attend que l'ecrivain libere des cases (les messages ne sont jamais perdus).
+ * Si le journal n'existe pas (outils annexes), le message est ecrit directement dans la console.
+ *
+ * \param colonne L'indice de la colonne.
+ * \param s Le message a deposer.
+ */
+void depose_enregistrement(int colonne, char* s)
+{
+	Enregistrement *e;
+	unsigned long position, sequence;
+	size_t longueur;
+
+	if (journal == -1) {
+		printf("%*s%s", colonne*COLONNE, "", s);
+		return;
+	}
+
+	if (anneau == NULL)
+		anneau = shmat(journal, NULL, 0);
+
+	do {
+		position = __atomic_load_n(&anneau->ecriture, __ATOMIC_RELAXED);
+		while (1) {
+			e = &anneau->enregistrements[position % NB_ENREGISTREMENTS];
+			sequence = __atomic_load_n(&e->sequence, __ATOMIC_ACQUIRE);
+			if (sequence == position) {
+				if (__atomic_compare_exchange_n(&anneau->ecriture, &position, position+1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+					break;
+			} else if ((long) (sequence - position) < 0) {
+				usleep(100);
+				position = __atomic_load_n(&anneau->ecriture, __ATOMIC_RELAXED);
+			} else {
+				position = __atomic_load_n(&anneau->ecriture, __ATOMIC_RELAXED);
+			}
+		}
+
+		longueur = strlen(s);
+		if (longueur > TAILLE_TEXTE-1)
+			longueur = TAILLE_TEXTE-1;
+		memcpy(e->texte, s, longueur);
+		e->texte[longueur] = '\0';
+		e->colonne = colonne;
+		__atomic_store_n(&e->sequence, position+1, __ATOMIC_RELEASE);
+
+		s += longueur;
+		colonne = -1;
+	} while (*s != '\0');
+}
+
+/**
+ * \fn void initialise_journal()
+ * \brief Cree le segment de memoire partagee de l'anneau du journal.
+ */
+void initialise_journal()
+{
+	int i;
+
+	journal = shmget(IPC_PRIVATE, sizeof(Journal), IPC_CREAT | 0666);
+	if (journal == -1) {
+		perror("Pb shmget journal");
+		exit(1);
+	}
+
+	anneau = shmat(journal, NULL, 0);
+	anneau->ecriture = 0;
+	anneau->lecture = 0;
+	anneau->fin = 0;
+	for (i=0;i<NB_ENREGISTREMENTS;i++)
+		anneau->enregistrements[i].sequence = i;
+}
+
+/**
+ * \fn pid_t forkEcrivain()
+ * \brief Cree le processus fils ecrivain du journal.
+ *
+ * \return Le pid de l'ecrivain.
+ */
+pid_t forkEcrivain()
+{
+	pid_t pid = fork();
+
+	if (pid == 0) {
+		ecrivain();
+		exit(0);
+	}
+
+	return pid;
+}
+
+/**
+ * \fn void ecrivain()
+ * \brief Fonction realisee par l'ecrivain du journal.
+ *
+ * Vide sans arret l'anneau dans un tampon (en appliquant le decalage des colonnes) et l'ecrit par lots dans la console et output.txt : un seul appel a write par destination et par lot.
+ * Ignore SIGINT pour pouvoir vider l'anneau jusqu'au bout ; se termine lorsque fin vaut 1 et que l'anneau est vide, ou si le processus principal disparait.
+ */
+void ecrivain()
+{
+	Enregistrement *e;
+	char *lot;
+	int sortie, taille = 0, blancs, longueur;
+	pid_t parent = getppid();
+
+	signal(SIGINT, SIG_IGN);
+
+	lot = malloc(TAILLE_LOT);
+	sortie = open("./output.txt", O_WRONLY | O_APPEND | O_CREAT, 0644);
+	if (lot == NULL || sortie == -1) {
+		perror("Pb ecrivain");
+		exit(1);
 	}
-	printf("%s",s);
-	fprintf(file, "%s", s);
-	fflush(stdout);
-	fclose(file);
+
+	while (1) {
+		e = &anneau->enregistrements[anneau->lecture % NB_ENREGISTREMENTS];
+
+		if (__atomic_load_n(&e->sequence, __ATOMIC_ACQUIRE) == anneau->lecture+1) {
+			blancs = (e->colonne > 0) ? e->colonne*COLONNE : 0;
+			longueur = strlen(e->texte);
+
+			if (taille + blancs + longueur > TAILLE_LOT) {
+				write(1, lot, taille);
+				write(sortie, lot, taille);
+				taille = 0;
+			}
+			if (blancs + longueur > TAILLE_LOT)
+				blancs = TAILLE_LOT - longueur;
+
+			memset(lot+taille, ' ', blancs);
+			memcpy(lot+taille+blancs, e->texte, longueur);
+			taille += blancs + longueur;
+
+			__atomic_store_n(&e->sequence, anneau->lecture + NB_ENREGISTREMENTS, __ATOMIC_RELEASE);
+			anneau->lecture++;
+			continue;
+		}
+
+		if (taille > 0) {
+			write(1, lot, taille);
+			write(sortie, lot, taille);
+			taille = 0;
+		}
+
+		if (__atomic_load_n(&anneau->fin, __ATOMIC_ACQUIRE) == 1 && anneau->lecture == __atomic_load_n(&anneau->ecriture, __ATOMIC_ACQUIRE))
+			break;
+		if (getppid() != parent)
+			break;
+
+		usleep(1000);
+	}
+
+	close(sortie);
+	free(lot);
+}
+
+/**
+ * \fn void termine_journal(pid_t pid_Ecrivain)
+ * \brief Demande a l'ecrivain de vider l'anneau, attend sa fin et detache le journal.
+ *
+ * \param pid_Ecrivain Le pid de l'ecrivain.
+ */
+void termine_journal(pid_t pid_Ecrivain)
+{
+	if (anneau == NULL)
+		return;
+
+	__atomic_store_n(&anneau->fin, 1, __ATOMIC_RELEASE);
+	waitpid(pid_Ecrivain, NULL, 0);
 }
@@ -1,10 +1,58 @@
 #ifndef __INTERFACE__
 #define __INTERFACE__
 
-char buffer[1024];
-char output[10240];
-FILE *file;
+#include <stdio.h>
+#include <sys/types.h>
+
+/*! Le nombre d'enregistrements de l'anneau du journal (puissance de 2). */
+#define NB_ENREGISTREMENTS 4096
+/*! La taille maximale du texte d'un enregistrement (les messages plus longs sont decoupes). */
+#define TAILLE_TEXTE 112
+
+/**
+ * \struct Enregistrement
+ * \brief Represente un message en attente d'ecriture dans l'anneau du journal.
+ */
+typedef struct Enregistrement {
+	unsigned long sequence;	/*!< Le numero de sequence de la case (protocole de l'anneau). */
+	int colonne;	/*!< L'indice de la colonne du message (-1 pour la suite d'un message decoupe, sans decalage). */
+	char texte[TAILLE_TEXTE];	/*!< Le texte du message (termine par un caractere nul). */
+} Enregistrement;
+
+/**
+ * \struct Journal
+ * \brief Represente l'anneau du journal, en memoire partagee entre tous les processus.
+ *
+ * Les emetteurs (voitures, carrefours, threads) reservent une case par compare-and-swap sur ecriture puis la publient via son numero de sequence.
+ * L'ecrivain, seul lecteur, vide l'anneau par lots vers la console et output.txt.
+ */
+typedef struct Journal {
+	unsigned long ecriture;	/*!< La prochaine position a reserver par un emetteur. */
+	char separation[64 - sizeof(unsigned long)];	/*!< Separe ecriture et lecture sur deux lignes de cache. */
+	unsigned long lecture;	/*!< La prochaine position a lire par l'ecrivain. */
+	int fin;	/*!< Passe a 1 pour demander a l'ecrivain de vider l'anneau et de se terminer. */
+	Enregistrement enregistrements[NB_ENREGISTREMENTS];	/*!< Les cases de l'anneau. */
+} Journal;
+
+extern char buffer[1024];
+extern char output[10240];
+extern FILE *file;
+
+extern int journal;	/*!< Le segment de memoire partagee de l'anneau du journal. */
+extern int silencieux;	/*!< 1 si seul le bilan de la simulation doit etre affiche (option "-q"). */
 
 void message(int i, char* s);
 
-#endif
\ No newline at end of file
+void bilan(char* s);
+
+void depose_enregistrement(int colonne, char* s);
+
+void initialise_journal();
+
+pid_t forkEcrivain();
+
+void ecrivain();
+
+void termine_journal(pid_t pid_Ecrivain);
+
+#endif
@@ -4,10 +4,14 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/ipc.h>
 #include <sys/shm.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <signal.h>
+#include <unistd.h>
+#include <time.h>
 #include <errno.h>
 #include "project.h"
 #include "main.h"
@@ -15,54 +19,212 @@
 #include "voiture.h"
 #include "carrefour.h"
 #include "serveur.h"
+#include "sem.h"
+#include "moteur.h"
+#include "trace.h"
+#include "simulation.h"
+#include "transport.h"
+#include "statistiques.h"
+#include "interblocage.h"
+#include "feux.h"
+#include "alea.h"
+#include "topologie.h"
+#include "charge.h"
+#include "mesure.h"
+#include "reprise.h"
+#include "noeuds.h"
 
-int tailleReq = sizeof(Requete) - sizeof(long);
+int tailleReq = sizeof(Message) - sizeof(long);
 int tailleRep = sizeof(Reponse) - sizeof(long);
 
 int msg_serveur;
-int msg_carrefour[4];
+int *msg_carrefour;
 int sem;
+int nb_semaphores;
 int compteur;
+int moteur = MOTEUR_PROCESSUS;
+int nb_threads = 0;
+int admission = ADMISSION_SERVEUR;
+int reservation = 0;
+int evitement = 0;
+int ordre = ORDRE_LIBRE;
+int feux = 0;
+int graine_fixee = 0;
+char *chemin_rapport = NULL;
+char *chemin_charge = NULL;
+char *chemin_reprise = NULL;
+char *chemin_debits = NULL;
+double debit_entrees = 0;
+long long duree_generation = 0;
 
-int carrefours[4];
+int carrefours;
+Carrefour *reseau;
 
 pid_t pid_Serveur;
-pid_t pid_Carrefour[4];
+pid_t pid_Ecrivain;
+pid_t *pid_Carrefour;
+pid_t *pid_Voitures;
+
+/*! Passe a 1 a la reception d'un signal SIGUSR1 : les statistiques sont affichees par la boucle principale du moteur (voir affiche_statistiques_demandees()). */
+volatile sig_atomic_t statistiques_demandees = 0;
 
 /**
- * \fn main(int argc,char* argv[])
+ * \fn int main(int argc,char* argv[])
  * \brief Cree les processus fils (voitures, carrefours, serveur), les objets IPC, affiche les premieres informations.
  */
-main(int argc,char* argv[])
+int main(int argc,char* argv[])
 {
+	int options, nb_voitures_terminees = 0;
+	long long debut;
+	pid_t done;
+	struct sigaction action;
+
 	file = fopen("./output.txt", "w");
 	fclose(file);
 
-	verif_arguments(argc-1, argv);
+	options = analyse_options(argc, argv);
+	argv[options] = argv[0];
+	argv += options;
+	argc -= options;
 
+	if (evitement == 1 && admission == ADMISSION_ATOMIQUE) {
+		printf("L'option -e n'est pas compatible avec -a.\n");
+		exit(-1);
+	}
+	if (evitement == 1 && ordre == ORDRE_TICKETS) {
+		printf("L'option -e n'est pas compatible avec -f.\n");
+		exit(-1);
+	}
+	if (feux == 1 && ordre == ORDRE_TICKETS) {
+		printf("L'option -c n'est pas compatible avec -f.\n");
+		exit(-1);
+	}
+	if (liste_noeuds != NULL && moteur != MOTEUR_THREADS) {
+		printf("L'option -n n'est disponible qu'avec le moteur -t.\n");
+		exit(-1);
+	}
+	if ((chemin_point != NULL || chemin_reprise != NULL) && moteur != MOTEUR_EVENEMENTS) {
+		printf("Les options -k et -K ne sont disponibles qu'avec le moteur -d.\n");
+		exit(-1);
+	}
+	if (charge_ouverte && (moteur == MOTEUR_PROCESSUS || liste_noeuds != NULL)) {
+		printf("Les options -o et -O ne sont disponibles qu'avec les moteurs -t et -d, sans -n.\n");
+		exit(-1);
+	}
+	if (charge_ouverte && (chemin_charge != NULL || chemin_point != NULL || chemin_reprise != NULL)) {
+		printf("Les options -o et -O ne sont pas compatibles avec -w, -k et -K.\n");
+		exit(-1);
+	}
+	if (charge_ouverte && duree_generation <= 0) {
+		printf("Veuillez entrer une duree de generation superieure a 0.\n");
+		exit(-1);
+	}
+	if (evitement == 1)
+		admission = ADMISSION_LOCALE;
+
+	initialise_topologie();
+	initialise_interblocage();
+	initialise_feux();
+	initialise_parcours();
+
+	if (chemin_reprise != NULL) {
+		ouvre_reprise(chemin_reprise);
+	} else if (chemin_charge != NULL) {
+		charge_fichier(chemin_charge);
+	} else {
+		verif_arguments(argc-1, argv);
+		if (charge_ouverte && argc-1 != 1) {
+			printf("Avec les options -o et -O, veuillez entrer le nombre maximal de voitures en route (NbVoitures).\n");
+			exit(-1);
+		}
+		if (argc-1 == 1)
+			charge_arguments(atoi(argv[1]), NULL);
+		else
+			charge_arguments((argc-1)/2, argv);
+		if (chemin_debits != NULL)
+			charge_debits(chemin_debits, duree_generation);
+		else if (charge_ouverte)
+			charge_debit(debit_entrees, duree_generation);
+	}
+
+	if (liste_noeuds != NULL)
+		connecte_noeuds();
+
+	if (!graine_fixee)
+		graine_globale = (moteur == MOTEUR_EVENEMENTS || liste_noeuds != NULL) ? 1 : (unsigned long long) time(NULL) ^ getpid();
+
+	nb_semaphores = moteur == MOTEUR_PROCESSUS ? 1 + nb_carrefours*25 : 1;
 	initialise_semaphore();
 	initialise_files();
+	initialise_transport(charge_nombre);
 	initialise_carrefours();
 	initialise_compteur();
+	initialise_journal();
+	initialise_statistiques(nb_carrefours);
+	if (chemin_rapport != NULL)
+		initialise_mesures(charge_ouverte ? arrivees_prevues() : charge_nombre);
+
+	pid_Ecrivain = forkEcrivain();
+
+	snprintf(buffer, sizeof(buffer), "Graine : %llu\n", graine_globale);
+	bilan(buffer);
+	snprintf(buffer, sizeof(buffer), "Grille : %d x %d carrefours\n", lignes, colonnes);
+	bilan(buffer);
+	if (nb_noeuds > 1)
+		annonce_noeud();
+	snprintf(buffer, sizeof(buffer), "Carrefours : segment %d (./tableau %d %d)\n", carrefours, carrefours, colonnes);
+	bilan(buffer);
+	if (stats != NULL) {
+		snprintf(buffer, sizeof(buffer), "Statistiques : segment %d (./releve %d, ou kill -USR1 %d)\n", statistiques, statistiques, getpid());
+		bilan(buffer);
+	}
+
+	debut = maintenant();
+
+	if (moteur != MOTEUR_PROCESSUS)
+		signal(SIGUSR1,traitantSIGUSR1);
+
+	if (moteur == MOTEUR_THREADS) {
+		moteur_threads(charge_nombre);
+		termine_simulation(debut);
+	}
+
+	if (moteur == MOTEUR_EVENEMENTS) {
+		simulation_evenements(charge_nombre);
+		termine_simulation(debut);
+	}
 
 	forkServeur(serveur);
 	forkCarrefours(carrefour);
 
-	if (argc-1 == 1) {
-		premiere_ligne(atoi(argv[1]));
-		forkVoitures(atoi(argv[1]), NULL, voiture);
-	} else {
-		premiere_ligne((argc-1)/2);
-		forkVoitures((argc-1)/2, argv, voiture);
-	}
+	premiere_ligne(charge_nombre);
+	forkVoitures(charge_nombre, voiture);
 
 	signal(SIGINT,traitantSIGINT);
+	/* Sans SA_RESTART : un SIGUSR1 interrompt waitpid(), pour que la boucle affiche aussitot les statistiques. */
+	action.sa_handler = traitantSIGUSR1;
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = 0;
+	sigaction(SIGUSR1, &action, NULL);
 
-	while (1) {
-		pid_t done = wait();
-		if (done == -1)
-		if (errno == ECHILD) break;
+	while (nb_voitures_terminees < charge_nombre) {
+		affiche_statistiques_demandees();
+		done = waitpid(-1, NULL, mesures != NULL ? WNOHANG : 0);
+		if (done == 0) {
+			if (voitures_bloquees())
+				break;
+			usleep(10*MINPAUSE);
+			continue;
+		}
+		if (done == -1) {
+			if (errno == ECHILD) break;
+			continue;
+		}
+		if (est_voiture(done))
+			nb_voitures_terminees++;
 	}
+
+	termine_simulation(debut);
 }
 
 /**
@@ -74,28 +236,153 @@ main(int argc,char* argv[])
 void erreurFin(const char* msg){ perror(msg); exit(1); }
 
 /**
- * \fn void forkVoitures(int nb, char *argv[], void (*fonction)())
- * \brief Cree nbFils processus fils (voitures) qui executent la meme fonction.
+ * \fn int analyse_options(int argc, char *argv[])
+ * \brief Analyse les options placees avant les arguments de la simulation.
+ *
+ * Les options reconnues sont :
+ * - "-t" : utilise le moteur a base de threads (MOTEUR_THREADS) au lieu d'un processus par voiture.
+ * - "-d" : utilise le moteur a evenements discrets (MOTEUR_EVENEMENTS) : temps virtuel, un seul processus, resultats reproductibles.
+ * - "-j N" : fixe le nombre de threads travailleurs du moteur a base de threads (1 par coeur par defaut).
+ * - "-q" : mode silencieux, seul le bilan de la simulation est affiche.
+ * - "-T fichier" : enregistre les requetes et reponses dans une trace binaire (a relire avec le programme rendu) ; implique le mode silencieux.
+ * - "-a" : les voitures reservent leurs places directement dans les carrefours par operations atomiques (ADMISSION_ATOMIQUE), sans passer par le serveur.
+ * - "-l" : chaque carrefour decide lui meme des admissions (ADMISSION_LOCALE), sans aller-retour avec le serveur ; sans effet sur les moteurs "-t" et "-d", qui decident deja localement.
+ * - "-e" : evite les interblocages : une demande n'est accordee que si toutes les voitures du carrefour peuvent encore en sortir (algorithme du banquier, voir interblocage.c). En MOTEUR_PROCESSUS, chaque carrefour decide alors lui meme (ADMISSION_LOCALE) ; incompatible avec "-a".
+ * - "-f" : les demandes sur une meme case d'un croisement (file avant, croisement, file apres) sont accordees dans leur ordre d'arrivee (ORDRE_TICKETS) ; incompatible avec "-e" (la demande la plus ancienne peut etre refusee par l'evitement alors qu'une plus recente serait sure) et sans effet avec "-p".
+ * - "-c" : regle la ligne d'arret de chaque voie (file avant de son premier croisement) par des feux : les voies qui ne se croisent pas forment des phases, et la phase verte s'adapte aux files du carrefour (voir feux.c) ; incompatible avec "-f", sans effet avec "-p".
+ * - "-p" : chaque voiture s'engage sur sa voie en une seule demande a son arrivee sur un carrefour, et la libere a sa sortie (reservation de parcours) : les voitures d'une meme voie se suivent, les voies qui la croisent attendent qu'elle se vide ; compatible avec tous les moteurs et modes d'admission.
+ * - "-r" : les requetes et reponses passent par des anneaux en memoire partagee (transport_anneaux) au lieu des files de message SysV ; MOTEUR_PROCESSUS seulement.
+ * - "-s graine" : fixe la graine des flux aleatoires des voitures (aleatoire par defaut, 1 pour le moteur a evenements discrets).
+ * - "-b fichier" : mesure la simulation (debit, durees des trajets, messages et temps CPU) et ajoute le rapport au fichier (une ligne JSON).
+ * - "-g fichier" : charge la grille de carrefours (lignes x colonnes, routes fermees) depuis un fichier de topologie (voir topologie.c) ; 2 x 2 carrefours par defaut.
+ * - "-w fichier" : lit les voitures a simuler et leurs dates d'arrivee dans un fichier de charge (cree par le programme genere) ; les voies et carrefours ne sont alors plus attendus.
+ * - "-n rang hote:port,hote:port,..." : repartit la simulation sur plusieurs noeuds (un par adresse, meme charge et meme graine, 1 par defaut) ; ce noeud a le rang donne et simule sa bande de lignes de carrefours (voir noeuds.c) ; MOTEUR_THREADS seulement.
+ * - "-k secondes fichier" : ecrit l'etat complet de la simulation dans un point de reprise a la date virtuelle donnee, puis s'arrete ; MOTEUR_EVENEMENTS seulement.
+ * - "-K fichier" : reprend la simulation depuis un point de reprise (voir reprise.c) ; les voitures ne sont alors plus attendues ; MOTEUR_EVENEMENTS seulement.
+ * - "-o debit secondes" : charge ouverte, les voitures arrivent en continu a chaque entree de la carte (processus de Poisson, debit en voiture par seconde) pendant la duree donnee, et NbVoitures est le nombre maximal de voitures en route (numeros recycles, voir charge.c) ; MOTEUR_THREADS et MOTEUR_EVENEMENTS seulement, incompatible avec "-n", "-w", "-k" et "-K".
+ * - "-O fichier secondes" : comme "-o", avec les debits de chaque entree et leur evolution au cours du temps lus dans un fichier de debits (voir charge_debits()).
  *
- * Si voies est NULL, cree nbFils voitures avec une voie aleatoire.
- * Si voies est non NULL, cree nbFils voitures avec une la voie correspondant aux differents membres de voies.
+ * L'analyse s'arrete au premier argument qui n'est pas une option reconnue (les voies et carrefours peuvent valoir -1).
+ *
+ * \param argc Le nombre d'arguments passes au programme.
+ * \param argv Les arguments passes au programme.
+ *
+ * \return Le nombre d'arguments consommes par les options.
+ */
+int analyse_options(int argc, char *argv[])
+{
+	int i = 1;
+
+	while (i < argc) {
+		if (strcmp(argv[i], "-t") == 0) {
+			moteur = MOTEUR_THREADS;
+			i++;
+		} else if (strcmp(argv[i], "-d") == 0) {
+			moteur = MOTEUR_EVENEMENTS;
+			i++;
+		} else if (strcmp(argv[i], "-q") == 0) {
+			silencieux = 1;
+			i++;
+		} else if (strcmp(argv[i], "-T") == 0 && i+1 < argc) {
+			ouvre_trace(argv[i+1]);
+			silencieux = 1;
+			i += 2;
+		} else if (strcmp(argv[i], "-a") == 0) {
+			admission = ADMISSION_ATOMIQUE;
+			i++;
+		} else if (strcmp(argv[i], "-r") == 0) {
+			transport = &transport_anneaux;
+			i++;
+		} else if (strcmp(argv[i], "-l") == 0) {
+			admission = ADMISSION_LOCALE;
+			i++;
+		} else if (strcmp(argv[i], "-e") == 0) {
+			evitement = 1;
+			i++;
+		} else if (strcmp(argv[i], "-f") == 0) {
+			ordre = ORDRE_TICKETS;
+			i++;
+		} else if (strcmp(argv[i], "-c") == 0) {
+			feux = 1;
+			i++;
+		} else if (strcmp(argv[i], "-p") == 0) {
+			reservation = 1;
+			i++;
+		} else if (strcmp(argv[i], "-s") == 0 && i+1 < argc) {
+			graine_globale = strtoull(argv[i+1], NULL, 10);
+			graine_fixee = 1;
+			i += 2;
+		} else if (strcmp(argv[i], "-b") == 0 && i+1 < argc) {
+			chemin_rapport = argv[i+1];
+			i += 2;
+		} else if (strcmp(argv[i], "-w") == 0 && i+1 < argc) {
+			chemin_charge = argv[i+1];
+			i += 2;
+		} else if (strcmp(argv[i], "-n") == 0 && i+2 < argc) {
+			rang_noeud = atoi(argv[i+1]);
+			liste_noeuds = argv[i+2];
+			i += 3;
+		} else if (strcmp(argv[i], "-k") == 0 && i+2 < argc) {
+			date_point = (long long) (atof(argv[i+1]) * 1000000);
+			chemin_point = argv[i+2];
+			i += 3;
+		} else if (strcmp(argv[i], "-o") == 0 && i+2 < argc) {
+			charge_ouverte = 1;
+			debit_entrees = atof(argv[i+1]);
+			duree_generation = (long long) (atof(argv[i+2]) * 1000000);
+			i += 3;
+		} else if (strcmp(argv[i], "-O") == 0 && i+2 < argc) {
+			charge_ouverte = 1;
+			chemin_debits = argv[i+1];
+			duree_generation = (long long) (atof(argv[i+2]) * 1000000);
+			i += 3;
+		} else if (strcmp(argv[i], "-K") == 0 && i+1 < argc) {
+			chemin_reprise = argv[i+1];
+			i += 2;
+		} else if (strcmp(argv[i], "-g") == 0 && i+1 < argc) {
+			charge_topologie(argv[i+1]);
+			i += 2;
+		} else if (strcmp(argv[i], "-j") == 0 && i+1 < argc && atoi(argv[i+1]) > 0) {
+			nb_threads = atoi(argv[i+1]);
+			i += 2;
+		} else {
+			break;
+		}
+	}
+
+	return i-1;
+}
+
+/**
+ * \fn void forkVoitures(int nbVoitures, void (*fonction)())
+ * \brief Cree nbVoitures processus fils (voitures) qui executent la meme fonction.
+ *
+ * Chaque voiture recoit la voie et le carrefour de son arrivee (voir arrivee_voiture()) et attend sa date d'arrivee avant de demarrer.
  *
  * \param nbVoitures Le nombre de voitures a creer.
- * \param argv Le tableau des voies et carrefours a affecter aux voitures le cas echeant.
  * \param fonction Pointeur sur la fonction qui sera exectuee par les voitures.
  */
-void forkVoitures(int nbVoitures, char *argv[], void (*fonction)())
+void forkVoitures(int nbVoitures, void (*fonction)())
 {
 	int i;
+	long long debut, attente;
+	Arrivee a;
 
-	if (argv == NULL) {
-		for (i=0;i<nbVoitures;i++)
-			if (fork()==0)
-				(*fonction) (i, -1, -1, 1);
-	} else {
-		for (i=0;i<nbVoitures;i++)
-			if (fork()==0)
-				(*fonction) (i, atoi(argv[1+(i*2)]), atoi(argv[2+(i*2)]), 1);
+	pid_Voitures = malloc(nbVoitures * sizeof(pid_t));
+	if (pid_Voitures == NULL)
+		erreurFin("Pb malloc voitures");
+
+	debut = maintenant();
+
+	for (i=0;i<nbVoitures;i++) {
+		pid_Voitures[i] = fork();
+		if (pid_Voitures[i] == 0) {
+			arrivee_voiture(i, &a);
+			attente = debut + a.date - maintenant();
+			if (attente > 0)
+				usleep(attente);
+			(*fonction) (i, a.voie, a.carrefour, 1);
+		}
 	}
 }
 
@@ -126,9 +413,9 @@ void verif_arguments(int arguments, char *argv[])
 			for (i=0;i<nbVoitures;i++) {
 				voie = atoi(argv[1+(i*2)]);
 				carrefour = atoi(argv[2+(i*2)]);
-				if ((voie > 0 && voie < 13 || voie == -1) && (carrefour > 0 && carrefour < 5 || carrefour == -1)) {
+				if ((voie > 0 && voie < 13 || voie == -1) && (carrefour > 0 && carrefour <= nb_carrefours || carrefour == -1)) {
 				} else {
-					printf("Veuillez entrer un numero de voie compris entre 1 et 12 inclus et un numero de carrefour compris entre 1 et 4 inclus. et du carrefour. Si vous souhaitez generer des valeurs aleatoires, mettez -1.\n");
+					printf("Veuillez entrer un numero de voie compris entre 1 et 12 inclus et un numero de carrefour compris entre 1 et %d inclus. Si vous souhaitez generer des valeurs aleatoires, mettez -1.\n", nb_carrefours);
 					exit(-1);
 				}
 			}
@@ -137,7 +424,7 @@ void verif_arguments(int arguments, char *argv[])
 			exit(-1);
 		}
 	} else {
-		printf("Syntaxe : ""./project Voie1 Carrefour1 Voie2 Carrefour2..."" OU ""./project NbVoitures"".\n");
+		printf("Syntaxe : ""./project [-t | -d] [-j N] [-n rang noeuds] [-a | -l] [-e] [-f] [-c] [-p] [-r] [-q] [-T fichier] [-s graine] [-b fichier] [-g fichier] [-k secondes fichier] Voie1 Carrefour1 Voie2 Carrefour2..."" OU ""./project [-t | -d] [-j N] [-n rang noeuds] [-a | -l] [-e] [-f] [-c] [-p] [-r] [-q] [-T fichier] [-s graine] [-b fichier] [-g fichier] [-k secondes fichier] NbVoitures"" OU ""./project [-t | -d] [-j N] [-a | -l] [-e] [-f] [-c] [-p] [-q] [-T fichier] [-s graine] [-b fichier] [-g fichier] [-o debit secondes | -O fichier secondes] NbVoitures"" OU ""./project [-t | -d] [-j N] [-n rang noeuds] [-a | -l] [-e] [-f] [-c] [-p] [-r] [-q] [-T fichier] [-s graine] [-b fichier] [-g fichier] [-k secondes fichier] -w fichier"" OU ""./project -d [-e] [-c] [-q] [-T fichier] [-b fichier] [-g fichier] [-k secondes fichier] -K fichier"".\n");
 		exit(-1);
 	}
 
@@ -146,7 +433,7 @@ void verif_arguments(int arguments, char *argv[])
 
 /**
  * \fn void forkCarrefours(void (*fonction)())
- * \brief Cree 4 processus fils (carrefours) qui executent la meme fonction.
+ * \brief Cree un processus fils par carrefour de la grille, qui executent tous la meme fonction.
  *
  * \param fonction Pointeur sur la fonction qui sera exectuee par les carrefours.
  */
@@ -154,7 +441,11 @@ void forkCarrefours(void (*fonction)())
 {
 	int i;
 
-	for (i=0;i<4;i++) {
+	pid_Carrefour = malloc(nb_carrefours * sizeof(pid_t));
+	if (pid_Carrefour == NULL)
+		erreurFin("Pb malloc carrefours");
+
+	for (i=0;i<nb_carrefours;i++) {
 		pid_Carrefour[i] = fork();
 
 		if (pid_Carrefour[i] == 0) {
@@ -178,32 +469,172 @@ void forkServeur(void (*fonction)())
 	}
 }
 
+/**
+ * \fn int est_voiture(pid_t pid)
+ * \brief Indique si un processus fils est une voiture (et non le serveur, un carrefour ou l'ecrivain).
+ *
+ * \param pid Le pid du processus fils.
+ *
+ * \return 1 si le processus est une voiture, 0 sinon.
+ */
+int est_voiture(pid_t pid)
+{
+	int i;
+
+	if (pid == pid_Serveur || pid == pid_Ecrivain)
+		return 0;
+	for (i=0;i<nb_carrefours;i++)
+		if (pid == pid_Carrefour[i])
+			return 0;
+	return 1;
+}
+
+/**
+ * \fn int voitures_bloquees()
+ * \brief Indique si les voitures (un processus par voiture) sont interbloquees. Necessite les mesures (option "-b").
+ *
+ * Une voiture refusee attend sa reponse sans emettre de requete : si aucune requete n'a ete emise pendant DUREE_INTERBLOCAGE, toutes les voitures ont termine leur pause et sont bloquees.
+ *
+ * \return 1 si les voitures sont interbloquees, 0 sinon.
+ */
+int voitures_bloquees()
+{
+	static long long requetes = -1, date = 0;
+
+	if (mesures->requetes != requetes) {
+		requetes = mesures->requetes;
+		date = maintenant();
+		return 0;
+	}
+
+	return maintenant() - date > DUREE_INTERBLOCAGE;
+}
+
+/**
+ * \fn void termine_simulation(long long debut)
+ * \brief Termine la simulation une fois toutes les voitures sorties (ou interbloquees) : arrete le serveur et les carrefours, vide le journal, ecrit le rapport de mesures le cas echeant et supprime les objets IPC.
+ *
+ * \param debut La date de debut de la simulation (en microseconde, voir maintenant()).
+ */
+void termine_simulation(long long debut)
+{
+	long long duree = maintenant() - debut;
+	int i, *c, bloquees = 0;
+
+	if (moteur == MOTEUR_PROCESSUS) {
+		for (i=0;i<charge_nombre;i++) {
+			if (waitpid(pid_Voitures[i], NULL, WNOHANG) == 0) {
+				kill(pid_Voitures[i], SIGKILL);
+				waitpid(pid_Voitures[i], NULL, 0);
+				bloquees++;
+			}
+		}
+		if (bloquees > 0) {
+			sprintf(buffer, "Interblocage : %d voitures bloquees\n", bloquees);
+			bilan(buffer);
+		}
+
+		kill(pid_Serveur, SIGKILL);
+		waitpid(pid_Serveur, NULL, 0);
+		for (i=0;i<nb_carrefours;i++) {
+			kill(pid_Carrefour[i], SIGKILL);
+			waitpid(pid_Carrefour[i], NULL, 0);
+		}
+	}
+
+	if (charge_ouverte)
+		bilan_charge_ouverte();
+	if (stats != NULL) {
+		sprintf(buffer, "Interblocages detectes : %lld, demandes refusees par l'evitement : %lld\n", stats->interblocages, stats->evitements);
+		bilan(buffer);
+		if (feux == 1) {
+			sprintf(buffer, "Changements de phase des feux : %lld\n", stats->phases);
+			bilan(buffer);
+		}
+	}
+
+	termine_journal(pid_Ecrivain);
+	ferme_trace();
+
+	if (chemin_rapport != NULL) {
+		c = shmat(compteur, NULL, 0);
+		rapport_mesures(chemin_rapport, duree, *c);
+		shmdt(c);
+	}
+
+	supprime_ipc();
+	exit(0);
+}
+
 /**
  * \fn void traitantSIGINT(int s)
  * \brief Redefini le traitant du signal SIGINT.
  *
- * Supprime les objets IPC et termine le programme lors de l'interception d'un signal SIGINT.
+ * Laisse l'ecrivain vider le journal, supprime les objets IPC et termine le programme lors de l'interception d'un signal SIGINT.
  *
  * \param s Le numero du signal intercepte (SIGINT).
  */
 void traitantSIGINT(int s)
 {
+	termine_journal(pid_Ecrivain);
+	ferme_trace();
+	supprime_ipc();
+
+	exit(0);
+}
+
+/**
+ * \fn void traitantSIGUSR1(int s)
+ * \brief Demande l'affichage des statistiques d'attente des croisements lors de l'interception d'un signal SIGUSR1, sans interrompre la simulation.
+ *
+ * Le traitant ne fait que lever un drapeau : l'affichage passe par stdio, qui n'est pas utilisable dans un traitant de signal.
+ *
+ * \param s Le numero du signal intercepte (SIGUSR1).
+ */
+void traitantSIGUSR1(int s)
+{
+	statistiques_demandees = 1;
+}
+
+/**
+ * \fn void affiche_statistiques_demandees()
+ * \brief Affiche les statistiques d'attente des croisements (sur la sortie d'erreur) si un signal SIGUSR1 les a demandees depuis le dernier appel.
+ *
+ * Appelee regulierement par la boucle principale de chaque moteur.
+ */
+void affiche_statistiques_demandees()
+{
+	if (!statistiques_demandees)
+		return;
+	statistiques_demandees = 0;
+	if (stats != NULL)
+		affiche_statistiques(stats, stderr);
+}
+
+/**
+ * \fn void supprime_ipc()
+ * \brief Supprime les objets IPC du projet (files de messages, semaphores, segments de memoire partagee).
+ */
+void supprime_ipc()
+{
+	int i;
+
 	if (
 			((msgctl(msg_serveur, IPC_RMID, NULL)) == -1) ||
-			((msgctl(msg_carrefour[0], IPC_RMID, NULL)) == -1) ||
-			((msgctl(msg_carrefour[1], IPC_RMID, NULL)) == -1) ||
-			((msgctl(msg_carrefour[2], IPC_RMID, NULL)) == -1) ||
-			((msgctl(msg_carrefour[3], IPC_RMID, NULL)) == -1) ||
-			((semctl(sem, 0, IPC_RMID, NULL)) == -1) ||
+			((shmctl(sem, IPC_RMID, NULL)) == -1) ||
 			((shmctl(compteur, IPC_RMID, NULL)) == -1) ||
-			((shmctl(carrefours[0], IPC_RMID, NULL)) == -1) ||
-			((shmctl(carrefours[1], IPC_RMID, NULL)) == -1) ||
-			((shmctl(carrefours[2], IPC_RMID, NULL)) == -1) ||
-			((shmctl(carrefours[3], IPC_RMID, NULL)) == -1)
+			((shmctl(journal, IPC_RMID, NULL)) == -1) ||
+			((shmctl(carrefours, IPC_RMID, NULL)) == -1)
 			)
 		erreurFin("Pb ipc_rmid");
 
-	exit(0);
+	for (i=0;i<nb_carrefours && moteur == MOTEUR_PROCESSUS;i++)
+		if ((msgctl(msg_carrefour[i], IPC_RMID, NULL)) == -1)
+			erreurFin("Pb ipc_rmid");
+
+	supprime_mesures();
+	supprime_statistiques();
+	supprime_transport();
 }
 
 /**
@@ -217,18 +648,16 @@ void traitantSIGINT(int s)
 void premiere_ligne(int num)
 {
 	int i;
-	P(MUTEX);
 	for (i = 0 ; i < num ; i++) {
 		snprintf(buffer, sizeof(buffer), "     %s  %d     ", "Voiture", i);
 		message(0, buffer);
 	}
 	message(0, "\n\n");
-	V(MUTEX);
 }
 
 /**
  * \fn void initialise_carrefours()
- * \brief Cree un segment de memoire partagee pour chaque carrefour.
+ * \brief Cree un segment de memoire partagee contenant tous les carrefours de la grille (\a reseau).
  *
  * Permet d'acceder aux informations des carrefours et de les modifier depuis les autres processus.
  * Initialise les carrefours avec certaines informations de base.
@@ -237,14 +666,17 @@ void initialise_carrefours()
 {
 	int i,j;
 	Carrefour base = {{{0},{0},{-1},{0},{0},{0},{0},{0},{0},{0},{-1},{0},{-1},{0},{-1},{0},{0},{0},{0},{0},{0},{0},{-1},{0},{0}}};
-	Carrefour *c;
 
-	for (i=0;i<4;i++) {
-		carrefours[i] = shmget(IPC_PRIVATE, sizeof(Carrefour), IPC_CREAT | 0666);
-		c = shmat(carrefours[i], NULL, 0);
-		
+	carrefours = shmget(IPC_PRIVATE, nb_carrefours * sizeof(Carrefour), IPC_CREAT | 0666);
+	if (carrefours == -1)
+		erreurFin("Pb shmget carrefours");
+	reseau = shmat(carrefours, NULL, 0);
+	if (reseau == (void *) -1)
+		erreurFin("Pb shmat carrefours");
+
+	for (i=0;i<nb_carrefours;i++) {
 		for (j=0;j<25;j++) {
-			c->croisements[j].etat = base.croisements[j].etat;
+			reseau[i].croisements[j].etat = base.croisements[j].etat;
 		}
 	}
 }
@@ -265,18 +697,22 @@ void initialise_compteur()
  * \brief Cree les files de messages du projet.
  *
  * Les files creees sont :
- * - 4 files pour les communications entre les voitures et les carrefours (1 par carrefour).
+ * - une file par carrefour de la grille pour les communications entre les voitures et les carrefours (MOTEUR_PROCESSUS seulement : les autres moteurs n'echangent pas de messages).
  * - 1 file pour les communications entre les carrefours et le serveur.
  *
  */
 void initialise_files()
 {
-	if (
-			((msg_serveur = msgget(IPC_PRIVATE, IPC_CREAT | 0600)) == -1) ||
-			((msg_carrefour[0] = msgget(IPC_PRIVATE, IPC_CREAT | 0600)) == -1) ||
-			((msg_carrefour[1] = msgget(IPC_PRIVATE, IPC_CREAT | 0600)) == -1) ||
-			((msg_carrefour[2] = msgget(IPC_PRIVATE, IPC_CREAT | 0600)) == -1) ||
-			((msg_carrefour[3] = msgget(IPC_PRIVATE, IPC_CREAT | 0600)) == -1)
-			)
+	int i;
+
+	if ((msg_serveur = msgget(IPC_PRIVATE, IPC_CREAT | 0600)) == -1)
 		erreurFin("Pb msgget");
+
+	msg_carrefour = malloc(nb_carrefours * sizeof(int));
+	if (msg_carrefour == NULL)
+		erreurFin("Pb malloc files");
+
+	for (i=0;i<nb_carrefours && moteur == MOTEUR_PROCESSUS;i++)
+		if ((msg_carrefour[i] = msgget(IPC_PRIVATE, IPC_CREAT | 0600)) == -1)
+			erreurFin("Pb msgget");
 }
@@ -3,12 +3,26 @@
 
 void erreurFin(const char* msg);
 
-void forkVoitures(int nb, char *argv[], void (*fonction)());
+int analyse_options(int argc, char *argv[]);
+
+void forkVoitures(int nbVoitures, void (*fonction)());
 
 void verif_arguments(int arguments, char *argv[]);
 
+int est_voiture(pid_t pid);
+
+int voitures_bloquees();
+
+void termine_simulation(long long debut);
+
 void traitantSIGINT(int s);
 
+void traitantSIGUSR1(int s);
+
+void affiche_statistiques_demandees();
+
+void supprime_ipc();
+
 void premiere_ligne(int num);
 
 void forkCarrefours(void (*fonction)());
@@ -0,0 +1,17 @@
+#ifndef __MESSAGE__
+#define __MESSAGE__
+
+#include "project.h"
+
+/*! La version du format des messages (4 bits, placee dans le second mot de chaque message). */
+#define VERSION_MESSAGE 1
+
+void encode_requete(Requete *req, Message *m);
+
+int decode_requete(Message *m, Requete *req);
+
+void encode_decision(Requete *req, int autorisation, Message *m);
+
+int autorisation_decision(Message *m);
+
+#endif
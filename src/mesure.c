@@ -0,0 +1,176 @@
+/**
+ * \file mesure.c
+ * \brief Contient les mesures de performance de la simulation (option "-b") : debit, durees des trajets, messages et temps CPU.
+ *
+ * Les compteurs et les durees des trajets sont places dans un segment de memoire partagee cree avant les fork : ils sont renseignes par operations atomiques depuis les voitures, les carrefours et le serveur, quel que soit le moteur.
+ * Le rapport est ajoute au fichier demande sous la forme d'un objet JSON par ligne.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include "project.h"
+#include "main.h"
+#include "mesure.h"
+#include "charge.h"
+#include "transport.h"
+#include "statistiques.h"
+
+Mesures *mesures = NULL;
+
+/*! Le segment de memoire partagee des mesures. */
+int segment_mesures = -1;
+/*! La taille du tableau des durees (le nombre de voitures, ou d'arrivees prevues en charge ouverte). */
+int nb_mesures;
+
+/**
+ * \fn void initialise_mesures(int nbVoitures)
+ * \brief Cree et attache le segment de memoire partagee des mesures.
+ *
+ * \param nbVoitures Le nombre de voitures de la simulation.
+ */
+void initialise_mesures(int nbVoitures)
+{
+	segment_mesures = shmget(IPC_PRIVATE, sizeof(Mesures) + nbVoitures * sizeof(long long), IPC_CREAT | 0666);
+	if (segment_mesures == -1)
+		erreurFin("Pb shmget mesures");
+	mesures = shmat(segment_mesures, NULL, 0);
+	if (mesures == (void *) -1)
+		erreurFin("Pb shmat mesures");
+	nb_mesures = nbVoitures;
+}
+
+/**
+ * \fn void compte_message()
+ * \brief Compte un message IPC envoye.
+ */
+void compte_message()
+{
+	if (mesures != NULL)
+		__atomic_add_fetch(&mesures->messages, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * \fn void compte_requete()
+ * \brief Compte une requete emise par une voiture.
+ */
+void compte_requete()
+{
+	if (mesures != NULL)
+		__atomic_add_fetch(&mesures->requetes, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * \fn void mesure_trajet(long long duree)
+ * \brief Enregistre la duree du trajet d'une voiture qui quitte la carte.
+ *
+ * \param duree La duree du trajet, de l'arrivee sur la carte a la sortie (en microseconde).
+ */
+void mesure_trajet(long long duree)
+{
+	long long i;
+
+	if (mesures == NULL)
+		return;
+
+	i = __atomic_fetch_add(&mesures->trajets, 1, __ATOMIC_RELAXED);
+	if (i < nb_mesures)
+		mesures->durees[i] = duree;
+}
+
+/**
+ * \fn int compare_durees(const void *a, const void *b)
+ * \brief Compare deux durees (pour qsort).
+ */
+int compare_durees(const void *a, const void *b)
+{
+	long long da = *(long long *) a, db = *(long long *) b;
+
+	return (da > db) - (da < db);
+}
+
+/**
+ * \fn long long centile(long long *durees, long long n, double p)
+ * \brief Retourne le centile p (0<p<1) d'un tableau de durees trie (methode du rang le plus proche).
+ */
+long long centile(long long *durees, long long n, double p)
+{
+	long long rang = (long long) (p * n + 0.999999);
+
+	if (n == 0)
+		return 0;
+	if (rang < 1)
+		rang = 1;
+	if (rang > n)
+		rang = n;
+	return durees[rang-1];
+}
+
+/**
+ * \fn void rapport_mesures(char *chemin, long long duree, int sorties)
+ * \brief Ajoute le rapport de la simulation au fichier chemin (une ligne JSON).
+ *
+ * Le temps CPU comprend le processus courant et tous ses fils termines : l'appeler apres avoir attendu les voitures, les carrefours, le serveur et l'ecrivain.
+ * Pour le moteur a evenements discrets, les durees des trajets sont en temps virtuel.
+ *
+ * \param chemin Le chemin du fichier de rapport.
+ * \param duree La duree reelle de la simulation (en microseconde).
+ * \param sorties Le nombre de voitures sorties de la carte.
+ */
+void rapport_mesures(char *chemin, long long duree, int sorties)
+{
+	struct rusage soi, fils;
+	long long n, cpu, p50 = 0, p99 = 0, p99_max = 0;
+	FILE *f;
+	char *noms_moteurs[] = {"processus", "threads", "evenements"};
+	char *noms_admissions[] = {"serveur", "atomique", "locale"};
+
+	if (mesures == NULL)
+		return;
+
+	getrusage(RUSAGE_SELF, &soi);
+	getrusage(RUSAGE_CHILDREN, &fils);
+	cpu = (soi.ru_utime.tv_sec + soi.ru_stime.tv_sec + fils.ru_utime.tv_sec + fils.ru_stime.tv_sec) * 1000000LL
+		+ soi.ru_utime.tv_usec + soi.ru_stime.tv_usec + fils.ru_utime.tv_usec + fils.ru_stime.tv_usec;
+
+	if (stats != NULL)
+		centiles_attentes(stats, &p50, &p99, &p99_max);
+
+	n = mesures->trajets < nb_mesures ? mesures->trajets : nb_mesures;
+	qsort(mesures->durees, n, sizeof(long long), compare_durees);
+
+	f = fopen(chemin, "a");
+	if (f == NULL)
+		erreurFin("Pb ouverture rapport");
+
+	fprintf(f, "{\"moteur\": \"%s\", \"admission\": \"%s\", \"transport\": \"%s\", \"reservation\": %d, \"voitures\": %d, \"sorties\": %d, \"maxfile\": %d, \"minpause_us\": %d, \"maxpause_us\": %d, \"graine\": %llu, ",
+			noms_moteurs[moteur], noms_admissions[admission], transport->nom, reservation, charge_nombre, sorties, MAXFILE, MINPAUSE, MAXPAUSE, graine_globale);
+	fprintf(f, "\"duree_s\": %.6f, \"voitures_par_s\": %.3f, ", duree/1000000.0, duree > 0 ? sorties * 1000000.0 / duree : 0.0);
+	fprintf(f, "\"latence_us\": {\"p50\": %lld, \"p99\": %lld, \"p999\": %lld, \"max\": %lld}, ",
+			centile(mesures->durees, n, 0.5), centile(mesures->durees, n, 0.99), centile(mesures->durees, n, 0.999), n > 0 ? mesures->durees[n-1] : 0);
+	fprintf(f, "\"messages_par_trajet\": %.3f, \"requetes_par_trajet\": %.3f, \"cpu_us_par_trajet\": %.3f, ",
+			sorties > 0 ? (double) mesures->messages / sorties : 0.0, sorties > 0 ? (double) mesures->requetes / sorties : 0.0, sorties > 0 ? (double) cpu / sorties : 0.0);
+	fprintf(f, "\"ordre\": \"%s\", \"attente_us\": {\"p50\": %lld, \"p99\": %lld, \"p99_max_croisement\": %lld}, ", ordre == ORDRE_TICKETS ? "tickets" : "libre", p50, p99, p99_max);
+	fprintf(f, "\"evitement\": %d, \"interblocages\": %lld, \"evitements\": %lld, \"feux\": %d, \"changements_phase\": %lld}\n",
+			evitement, stats != NULL ? stats->interblocages : 0, stats != NULL ? stats->evitements : 0, feux, stats != NULL ? stats->phases : 0);
+
+	fclose(f);
+}
+
+/**
+ * \fn void supprime_mesures()
+ * \brief Supprime le segment de memoire partagee des mesures.
+ */
+void supprime_mesures()
+{
+	if (segment_mesures == -1)
+		return;
+
+	shmdt(mesures);
+	shmctl(segment_mesures, IPC_RMID, NULL);
+	mesures = NULL;
+	segment_mesures = -1;
+}
@@ -0,0 +1,31 @@
+#ifndef __MESURE__
+#define __MESURE__
+
+#include "project.h"
+
+/**
+ * \struct Mesures
+ * \brief Represente les mesures d'une simulation (option "-b"), partagees entre tous les processus.
+ */
+typedef struct Mesures {
+	long long messages;	/*!< Le nombre de messages IPC envoyes (voitures, carrefours et serveur). */
+	long long requetes;	/*!< Le nombre de requetes emises par les voitures. */
+	long long trajets;	/*!< Le nombre de trajets termines (<=> de durees renseignees). */
+	long long durees[];	/*!< La duree du trajet de chaque voiture (en microseconde). */
+} Mesures;
+
+extern Mesures *mesures;	/*!< Les mesures de la simulation (NULL si elles ne sont pas demandees). */
+
+void initialise_mesures(int nbVoitures);
+
+void compte_message();
+
+void compte_requete();
+
+void mesure_trajet(long long duree);
+
+void rapport_mesures(char *chemin, long long duree, int sorties);
+
+void supprime_mesures();
+
+#endif
@@ -0,0 +1,584 @@
+/**
+ * \file moteur.c
+ * \brief Contient le moteur de simulation a base de threads (alternative aux processus voitures / carrefours / serveur).
+ *
+ * Ici, les voitures ne sont plus des processus mais de simples etats (EtatVoiture) avances pas a pas par etape_voiture().
+ * Un ensemble fixe de threads travailleurs (1 par coeur) se partage les voitures pretes : chacun possede sa propre file et vole dans celles des autres lorsqu'elle est vide.
+ * Les pauses des voitures ne sont plus des usleep() : un thread minuteur conserve les voitures en pause dans un calendrier et les rend pretes a la date voulue.
+ * En charge ouverte (options "-o" et "-O"), un thread generateur fait entrer les voitures au fil des arrivees, a leur date reelle.
+ * Dans une simulation repartie (option "-n", voir noeuds.c), le moteur ne simule que les carrefours de son noeud : les voitures qui en sortent sont envoyees aux autres noeuds, et celles qu'ils envoient sont programmees dans le calendrier.
+ * Comme le moteur a evenements discrets, le moteur s'arrete sur un interblocage : le minuteur constate qu'aucune voiture n'a progresse depuis DUREE_INTERBLOCAGE, ou qu'un cycle de cases pleines a ete detecte (voir minuteur()).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/types.h>
+#include "project.h"
+#include "main.h"
+#include "interface.h"
+#include "voiture.h"
+#include "carrefour.h"
+#include "serveur.h"
+#include "moteur.h"
+#include "charge.h"
+#include "mesure.h"
+#include "statistiques.h"
+#include "reprise.h"
+#include "noeuds.h"
+#include "simulation.h"
+
+/*! Protegent les decisions et mises a jour des carrefours (1 verrou par croisement de chaque carrefour de la grille). */
+pthread_mutex_t (*verrous_croisements)[25];
+
+/*! Le nombre de threads travailleurs. */
+int nb_travailleurs;
+/*! Les files de voitures pretes (1 par travailleur). */
+FileTaches *files_taches;
+/*! Le nombre total de voitures pretes (toutes files confondues). */
+int nb_pretes;
+/*! Le nombre de travailleurs endormis faute de voiture prete. */
+int nb_dormeurs;
+/*! Protege l'endormissement / le reveil des travailleurs. */
+pthread_mutex_t verrou_attente = PTHREAD_MUTEX_INITIALIZER;
+/*! Signale aux travailleurs qu'une voiture est prete. */
+pthread_cond_t travail = PTHREAD_COND_INITIALIZER;
+/*! Signale au thread principal la fin de la simulation (attente sur l'horloge monotone). */
+pthread_cond_t arret_moteur;
+
+/*! Les voitures en pause, ordonnees par date de reveil. */
+Calendrier calendrier_moteur;
+/*! Protege le calendrier. */
+pthread_mutex_t verrou_calendrier = PTHREAD_MUTEX_INITIALIZER;
+/*! Signale au minuteur qu'une voiture a ete programmee avant la prochaine echeance (attente sur l'horloge monotone). */
+pthread_cond_t reveil_minuteur;
+
+/*! Les etats de toutes les voitures (indices par leur numero). */
+EtatVoiture *voitures_moteur;
+/*! Le nombre de voitures a faire sortir avant la fin de la simulation. */
+int nb_voitures_moteur;
+/*! Le nombre de voitures sorties. */
+int nb_sorties;
+/*! Passe a 1 lorsque toutes les voitures sont sorties. */
+int fin_moteur;
+/*! La date de debut de la simulation (origine des dates d'arrivee). */
+long long debut_moteur;
+/*! La date de la derniere progression d'une voiture (autorisation accordee ou etape sans demande, voir progression_voiture()). */
+long long derniere_progression_moteur;
+/*! La cause de l'arret de la simulation sur un interblocage (INTERBLOCAGE_PROGRESSION ou INTERBLOCAGE_DETECTE), 0 sinon. */
+int interblocage_moteur;
+
+/**
+ * \fn void moteur_threads(int nbVoitures)
+ * \brief Lance la simulation avec le moteur a base de threads et attend la sortie de toutes les voitures.
+ *
+ * Les voitures recoivent la voie et le carrefour de leur arrivee (voir arrivee_voiture()) ; celles qui n'arrivent pas a la date 0 sont programmees dans le calendrier.
+ * Dans une simulation repartie, seules les voitures qui arrivent sur un carrefour du noeud sont lancees.
+ * En charge ouverte, aucune voiture n'est lancee d'avance : le thread generateur les fait entrer au fil des arrivees.
+ * La simulation s'arrete aussi sur un interblocage (voir minuteur()) : les voitures restees dans le calendrier et les files sont alors comptees comme bloquees, ou comme en route si un cycle a ete detecte avant que toutes soient arretees.
+ *
+ * \param nbVoitures Le nombre de voitures a creer (en charge ouverte : le nombre maximal de voitures en route).
+ */
+void moteur_threads(int nbVoitures)
+{
+	EtatVoiture *voitures;
+	pthread_t *threads, thread_minuteur, thread_generateur;
+	pthread_condattr_t attributs;
+	struct timespec attente;
+	long long debut, demarrage, echeance;
+	Arrivee a;
+	int i, j, *c;
+
+	debut_moteur = debut = maintenant();
+
+	verrous_croisements = malloc(nb_carrefours * sizeof(*verrous_croisements));
+	if (verrous_croisements == NULL)
+		erreurFin("Pb malloc verrous");
+
+	for (i=0;i<nb_carrefours;i++) {
+		for (j=0;j<25;j++)
+			pthread_mutex_init(&verrous_croisements[i][j], NULL);
+	}
+
+	pthread_condattr_init(&attributs);
+	pthread_condattr_setclock(&attributs, CLOCK_MONOTONIC);
+	pthread_cond_init(&reveil_minuteur, &attributs);
+	pthread_cond_init(&arret_moteur, &attributs);
+	pthread_condattr_destroy(&attributs);
+
+	nb_travailleurs = nb_threads;
+	if (nb_travailleurs == 0)
+		nb_travailleurs = sysconf(_SC_NPROCESSORS_ONLN);
+	if (nb_travailleurs < 1)
+		nb_travailleurs = 1;
+
+	voitures_moteur = voitures = malloc(nbVoitures * sizeof(EtatVoiture));
+	files_taches = malloc(nb_travailleurs * sizeof(FileTaches));
+	threads = malloc(nb_travailleurs * sizeof(pthread_t));
+	if (voitures == NULL || files_taches == NULL || threads == NULL)
+		erreurFin("Pb malloc moteur");
+
+	for (i=0;i<nb_travailleurs;i++) {
+		files_taches[i].capacite = nbVoitures/nb_travailleurs + 16;
+		files_taches[i].taches = malloc(files_taches[i].capacite * sizeof(EtatVoiture *));
+		if (files_taches[i].taches == NULL)
+			erreurFin("Pb malloc moteur");
+		files_taches[i].debut = 0;
+		files_taches[i].nombre = 0;
+		pthread_mutex_init(&files_taches[i].verrou, NULL);
+	}
+
+	initialise_calendrier(&calendrier_moteur, nbVoitures);
+	nb_voitures_moteur = nbVoitures;
+	nb_sorties = 0;
+	nb_pretes = 0;
+	nb_dormeurs = 0;
+	fin_moteur = 0;
+	interblocage_moteur = 0;
+	derniere_progression_moteur = debut;
+
+	for (i=0;i<nbVoitures && !charge_ouverte;i++) {
+		arrivee_voiture(i, &a);
+		initialise_etat(&voitures[i], i, a.voie, a.carrefour);
+		voitures[i].arrivee = debut + a.date;
+		if (proprietaire(voitures[i].v.carrefour) != rang_noeud)
+			continue;
+		if (a.date == 0)
+			rend_prete(i % nb_travailleurs, &voitures[i]);
+		else
+			programme(&calendrier_moteur, debut + a.date, &voitures[i]);
+	}
+
+	if (nb_noeuds > 1)
+		demarre_noeuds();
+	pthread_create(&thread_minuteur, NULL, minuteur, NULL);
+	for (i=0;i<nb_travailleurs;i++)
+		pthread_create(&threads[i], NULL, travailleur, (void *) (long) i);
+	if (charge_ouverte)
+		pthread_create(&thread_generateur, NULL, generateur, NULL);
+
+	demarrage = maintenant();
+
+	/* Le thread principal ne simule rien : il affiche les statistiques demandees par SIGUSR1 jusqu'a la fin de la simulation. */
+	pthread_mutex_lock(&verrou_attente);
+	while (!fin_moteur) {
+		pthread_mutex_unlock(&verrou_attente);
+		affiche_statistiques_demandees();
+		pthread_mutex_lock(&verrou_attente);
+		echeance = maintenant() + PERIODE_SIGNAUX;
+		attente.tv_sec = echeance / 1000000;
+		attente.tv_nsec = (echeance % 1000000) * 1000;
+		if (!fin_moteur)
+			pthread_cond_timedwait(&arret_moteur, &verrou_attente, &attente);
+	}
+	pthread_mutex_unlock(&verrou_attente);
+
+	for (i=0;i<nb_travailleurs;i++)
+		pthread_join(threads[i], NULL);
+	pthread_join(thread_minuteur, NULL);
+	if (charge_ouverte)
+		pthread_join(thread_generateur, NULL);
+
+	c = shmat(compteur, NULL, 0);
+	*c = nb_sorties;
+	sprintf(buffer, "%d Voitures sont sorties\n", *c);
+	bilan(buffer);
+	if (interblocage_moteur == INTERBLOCAGE_PROGRESSION) {
+		sprintf(buffer, "Interblocage : %d voitures bloquees depuis %.3f s\n", calendrier_moteur.taille + nb_pretes, (maintenant()-derniere_progression_moteur)/1000000.0);
+		bilan(buffer);
+	} else if (interblocage_moteur == INTERBLOCAGE_DETECTE) {
+		sprintf(buffer, "Interblocage detecte : arret avec %d voitures en route\n", calendrier_moteur.taille + nb_pretes);
+		bilan(buffer);
+	}
+	sprintf(buffer, "%d threads, demarrage en %.3f ms, simulation en %.3f s\n", nb_travailleurs, (demarrage-debut)/1000.0, (maintenant()-demarrage)/1000000.0);
+	bilan(buffer);
+	if (nb_noeuds > 1)
+		bilan_noeud();
+	shmdt(c);
+
+	for (i=0;i<nb_travailleurs;i++)
+		free(files_taches[i].taches);
+	for (i=0;i<nb_carrefours;i++)
+		for (j=0;j<25;j++)
+			pthread_mutex_destroy(&verrous_croisements[i][j]);
+	free(verrous_croisements);
+	detruit_calendrier(&calendrier_moteur);
+	pthread_cond_destroy(&reveil_minuteur);
+	pthread_cond_destroy(&arret_moteur);
+	free(files_taches);
+	free(threads);
+	free(voitures);
+}
+
+/**
+ * \fn long long maintenant()
+ * \brief Retourne la date courante (horloge monotone) en microseconde.
+ */
+long long maintenant()
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (long long) t.tv_sec * 1000000 + t.tv_nsec / 1000;
+}
+
+/**
+ * \fn int demande_moteur(Requete *req)
+ * \brief Traite une requete d'une voiture (equivalent du trajet voiture -> carrefour -> serveur -> carrefour -> voiture).
+ *
+ * La decision (decision()) et la mise a jour du carrefour (maj_croisements()) sont faites sous les memes verrous, donc de maniere atomique.
+ * Seuls les verrous du croisement et du croisement precedent sont pris, par indice croissant (meme ordre que operation_croisements()).
+ * En ADMISSION_ATOMIQUE, aucun verrou n'est pris : reserve_croisement() opere directement sur les compteurs par compare-and-swap.
+ * De meme en reservation de parcours, ou les seules requetes (MESSRESERVE, MESSSORT) portent sur l'occupation du carrefour (un seul mot).
+ * Avec l'evitement des interblocages, la decision porte sur tout le carrefour : une MESSDEMANDE prend les 25 verrous du carrefour, par indice croissant.
+ * Une autorisation accordee date la derniere progression (voir minuteur()).
+ *
+ * \param req Pointeur sur la requete de la voiture.
+ *
+ * \return L'autorisation (toujours 1 pour un MESSSORT).
+ */
+int demande_moteur(Requete *req)
+{
+	Carrefour *c = &reseau[req->carrefour-1];
+	pthread_mutex_t *verrous = verrous_croisements[req->carrefour-1];
+	int i = req->croisement, j = req->croisement_precedent, tmp, k;
+	int autorisation = 1;
+
+	if (admission == ADMISSION_ATOMIQUE || reservation == 1) {
+		autorisation = reserve_croisement(req, c);
+	} else if (evitement == 1 && req->type == MESSDEMANDE) {
+		for (k=0;k<25;k++)
+			pthread_mutex_lock(&verrous[k]);
+		autorisation = decision(c, req);
+		if (autorisation == 1)
+			maj_croisements(req, c);
+		for (k=24;k>=0;k--)
+			pthread_mutex_unlock(&verrous[k]);
+	} else {
+		if (i == -1 || i == j) {
+			i = j;
+			j = -1;
+		}
+		if (j != -1 && j < i) {
+			tmp = i;
+			i = j;
+			j = tmp;
+		}
+
+		if (i != -1)
+			pthread_mutex_lock(&verrous[i]);
+		if (j != -1)
+			pthread_mutex_lock(&verrous[j]);
+
+		if (req->type == MESSDEMANDE)
+			autorisation = decision(c, req);
+		if (autorisation == 1)
+			maj_croisements(req, c);
+
+		if (j != -1)
+			pthread_mutex_unlock(&verrous[j]);
+		if (i != -1)
+			pthread_mutex_unlock(&verrous[i]);
+	}
+
+	if (autorisation == 1)
+		__atomic_store_n(&derniere_progression_moteur, maintenant(), __ATOMIC_RELAXED);
+
+	return autorisation;
+}
+
+/**
+ * \fn void depose(FileTaches *f, EtatVoiture *e)
+ * \brief Ajoute une voiture en queue de file (agrandit la file si necessaire).
+ *
+ * \param f Pointeur sur la file.
+ * \param e Pointeur sur la voiture.
+ */
+void depose(FileTaches *f, EtatVoiture *e)
+{
+	EtatVoiture **taches;
+	int i;
+
+	pthread_mutex_lock(&f->verrou);
+	if (f->nombre == f->capacite) {
+		taches = malloc(2 * f->capacite * sizeof(EtatVoiture *));
+		if (taches == NULL)
+			erreurFin("Pb malloc file");
+		for (i=0;i<f->nombre;i++)
+			taches[i] = f->taches[(f->debut+i) % f->capacite];
+		free(f->taches);
+		f->taches = taches;
+		f->debut = 0;
+		f->capacite *= 2;
+	}
+	f->taches[(f->debut+f->nombre) % f->capacite] = e;
+	f->nombre++;
+	pthread_mutex_unlock(&f->verrou);
+}
+
+/**
+ * \fn EtatVoiture *reprend(FileTaches *f)
+ * \brief Retire la voiture en queue de file (utilise par le proprietaire de la file).
+ *
+ * \param f Pointeur sur la file.
+ *
+ * \return La voiture retiree, ou NULL si la file est vide.
+ */
+EtatVoiture *reprend(FileTaches *f)
+{
+	EtatVoiture *e = NULL;
+
+	pthread_mutex_lock(&f->verrou);
+	if (f->nombre > 0) {
+		f->nombre--;
+		e = f->taches[(f->debut+f->nombre) % f->capacite];
+	}
+	pthread_mutex_unlock(&f->verrou);
+
+	return e;
+}
+
+/**
+ * \fn EtatVoiture *vole(FileTaches *f)
+ * \brief Retire la voiture en tete de file (utilise par les autres travailleurs).
+ *
+ * \param f Pointeur sur la file.
+ *
+ * \return La voiture retiree, ou NULL si la file est vide.
+ */
+EtatVoiture *vole(FileTaches *f)
+{
+	EtatVoiture *e = NULL;
+
+	pthread_mutex_lock(&f->verrou);
+	if (f->nombre > 0) {
+		e = f->taches[f->debut];
+		f->debut = (f->debut+1) % f->capacite;
+		f->nombre--;
+	}
+	pthread_mutex_unlock(&f->verrou);
+
+	return e;
+}
+
+/**
+ * \fn void rend_prete(int numero, EtatVoiture *e)
+ * \brief Depose une voiture dans la file d'un travailleur et reveille un travailleur endormi le cas echeant.
+ *
+ * \param numero L'indice du travailleur destinataire.
+ * \param e Pointeur sur la voiture.
+ */
+void rend_prete(int numero, EtatVoiture *e)
+{
+	depose(&files_taches[numero], e);
+	__atomic_add_fetch(&nb_pretes, 1, __ATOMIC_SEQ_CST);
+
+	if (__atomic_load_n(&nb_dormeurs, __ATOMIC_SEQ_CST) > 0) {
+		pthread_mutex_lock(&verrou_attente);
+		pthread_cond_signal(&travail);
+		pthread_mutex_unlock(&verrou_attente);
+	}
+}
+
+/**
+ * \fn void *travailleur(void *arg)
+ * \brief Fonction realisee par chaque thread travailleur.
+ *
+ * Reprend une voiture prete dans sa file (ou en vole une a un autre travailleur), la fait avancer d'une etape puis :
+ * - la redepose dans sa file si l'etape suivante est immediate ;
+ * - la confie au minuteur si elle doit faire une pause (ou reessayer apres un refus) ;
+ * - la compte comme sortie si elle a quitte la carte (et rend son numero en charge ouverte) ;
+ * - l'envoie au noeud proprietaire de son prochain carrefour, dans une simulation repartie.
+ *
+ * \param arg L'indice du travailleur.
+ */
+void *travailleur(void *arg)
+{
+	int numero = (int) (long) arg;
+	EtatVoiture *e;
+	int i, pause, sorties;
+
+	while (!__atomic_load_n(&fin_moteur, __ATOMIC_ACQUIRE)) {
+		e = reprend(&files_taches[numero]);
+		for (i=1;e == NULL && i<nb_travailleurs;i++)
+			e = vole(&files_taches[(numero+i) % nb_travailleurs]);
+
+		if (e == NULL) {
+			pthread_mutex_lock(&verrou_attente);
+			__atomic_add_fetch(&nb_dormeurs, 1, __ATOMIC_SEQ_CST);
+			while (__atomic_load_n(&nb_pretes, __ATOMIC_SEQ_CST) == 0 && !fin_moteur)
+				pthread_cond_wait(&travail, &verrou_attente);
+			__atomic_sub_fetch(&nb_dormeurs, 1, __ATOMIC_SEQ_CST);
+			pthread_mutex_unlock(&verrou_attente);
+			continue;
+		}
+		__atomic_sub_fetch(&nb_pretes, 1, __ATOMIC_SEQ_CST);
+
+		pause = etape_voiture(e, demande_moteur, maintenant());
+
+		if (pause == FIN) {
+			mesure_trajet(maintenant() - e->arrivee);
+			sorties = __atomic_add_fetch(&nb_sorties, 1, __ATOMIC_SEQ_CST);
+			if (charge_ouverte) {
+				if (sortie_voiture(e->v.numero, maintenant() - debut_moteur))
+					termine_moteur();
+			} else if (sorties == nb_voitures_moteur && nb_noeuds == 1)
+				termine_moteur();
+			else if (nb_noeuds > 1)
+				sortie_noeud();
+		} else if (pause == 0) {
+			rend_prete(numero, e);
+		} else if (e->etape == ENTREE && proprietaire(e->v.carrefour) != rang_noeud) {
+			envoie_voiture(e, pause);
+		} else {
+			pthread_mutex_lock(&verrou_calendrier);
+			programme(&calendrier_moteur, maintenant() + pause, e);
+			if (calendrier_moteur.tas[0].e == e)
+				pthread_cond_signal(&reveil_minuteur);
+			pthread_mutex_unlock(&verrou_calendrier);
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * \fn void *minuteur(void *arg)
+ * \brief Fonction realisee par le thread minuteur.
+ *
+ * Dort jusqu'a la prochaine echeance du calendrier, puis rend pretes (en les repartissant entre les travailleurs) toutes les voitures dont la pause est terminee.
+ *
+ * Une voiture refusee reessaie apres MINPAUSE en repassant par le calendrier : si aucune voiture n'a progresse depuis DUREE_INTERBLOCAGE (voir demande_moteur() et progression_voiture()), toutes ont termine leur pause et sont bloquees.
+ * De meme, un cycle de cases pleines compte dans les statistiques (voir detecte_interblocage()) ne se defait jamais : ses voitures ne sortiront pas, et la simulation ne peut plus se terminer.
+ * Dans les deux cas, le minuteur arrete la simulation a la voiture suivante (et celle des autres noeuds d'une simulation repartie, voir arrete_noeuds()).
+ *
+ * \param arg Inutilise.
+ */
+void *minuteur(void *arg)
+{
+	Evenement ev;
+	struct timespec echeance;
+	long long date;
+	int suivant = 0, arret;
+
+	pthread_mutex_lock(&verrou_calendrier);
+	while (!__atomic_load_n(&fin_moteur, __ATOMIC_ACQUIRE)) {
+		if (calendrier_moteur.taille == 0) {
+			pthread_cond_wait(&reveil_minuteur, &verrou_calendrier);
+			continue;
+		}
+
+		date = calendrier_moteur.tas[0].date;
+		if (date > maintenant()) {
+			echeance.tv_sec = date / 1000000;
+			echeance.tv_nsec = (date % 1000000) * 1000;
+			pthread_cond_timedwait(&reveil_minuteur, &verrou_calendrier, &echeance);
+			continue;
+		}
+
+		prochain(&calendrier_moteur, &ev);
+		arret = 0;
+		if (progression_voiture(ev.e))
+			__atomic_store_n(&derniere_progression_moteur, maintenant(), __ATOMIC_RELAXED);
+		else if (maintenant() - __atomic_load_n(&derniere_progression_moteur, __ATOMIC_RELAXED) > DUREE_INTERBLOCAGE)
+			arret = INTERBLOCAGE_PROGRESSION;
+		if (stats != NULL && __atomic_load_n(&stats->interblocages, __ATOMIC_RELAXED) > 0)
+			arret = INTERBLOCAGE_DETECTE;
+
+		if (arret != 0) {
+			/* La voiture reste comptee parmi les bloquees ; termine_moteur() prend le verrou du calendrier. */
+			programme(&calendrier_moteur, ev.date, ev.e);
+			pthread_mutex_unlock(&verrou_calendrier);
+			interblocage_moteur = arret;
+			if (nb_noeuds > 1)
+				arrete_noeuds();
+			termine_moteur();
+			return NULL;
+		}
+		rend_prete(suivant, ev.e);
+		suivant = (suivant+1) % nb_travailleurs;
+	}
+	pthread_mutex_unlock(&verrou_calendrier);
+
+	return NULL;
+}
+
+/**
+ * \fn void *generateur(void *arg)
+ * \brief Fonction realisee par le thread generateur d'une charge ouverte.
+ *
+ * Dort jusqu'a la date de chaque arrivee, puis fait entrer la voiture sous un numero libre et la rend prete.
+ * La duree du trajet est comptee depuis la date prevue de l'arrivee : un retard du generateur ne raccourcit pas les trajets mesures.
+ *
+ * \param arg Inutilise.
+ */
+void *generateur(void *arg)
+{
+	struct timespec echeance;
+	Arrivee a;
+	long long date;
+	int numero, suivant = 0;
+
+	while (prochaine_arrivee(&a)) {
+		date = debut_moteur + a.date;
+		echeance.tv_sec = date / 1000000;
+		echeance.tv_nsec = (date % 1000000) * 1000;
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &echeance, NULL) == EINTR);
+
+		numero = entree_voiture(voitures_moteur, &a);
+		if (numero == -1)
+			continue;
+		voitures_moteur[numero].arrivee = date;
+		rend_prete(suivant, &voitures_moteur[numero]);
+		suivant = (suivant+1) % nb_travailleurs;
+	}
+
+	if (fin_generation())
+		termine_moteur();
+
+	return NULL;
+}
+
+/**
+ * \fn void termine_moteur()
+ * \brief Termine la simulation : reveille les travailleurs, le minuteur et le thread principal, qui s'arretent.
+ */
+void termine_moteur()
+{
+	pthread_mutex_lock(&verrou_attente);
+	__atomic_store_n(&fin_moteur, 1, __ATOMIC_RELEASE);
+	pthread_cond_broadcast(&travail);
+	pthread_cond_signal(&arret_moteur);
+	pthread_mutex_unlock(&verrou_attente);
+	pthread_mutex_lock(&verrou_calendrier);
+	pthread_cond_signal(&reveil_minuteur);
+	pthread_mutex_unlock(&verrou_calendrier);
+}
+
+/**
+ * \fn void accueille_voiture(VoitureReprise *v, int pause)
+ * \brief Programme une voiture envoyee par un autre noeud a l'issue de sa pause.
+ *
+ * \param v Pointeur sur la voiture recue (sa date d'arrivee est la duree deja ecoulee de son trajet).
+ * \param pause La pause de la voiture avant son arrivee sur le carrefour (en microseconde).
+ */
+void accueille_voiture(VoitureReprise *v, int pause)
+{
+	EtatVoiture *e;
+
+	if (v->numero < 0 || v->numero >= nb_voitures_moteur || restaure_voiture(&voitures_moteur[v->numero], v) == 0) {
+		printf("Voiture %d invalide recue d'un autre noeud.\n", v->numero);
+		exit(-1);
+	}
+
+	e = &voitures_moteur[v->numero];
+	e->arrivee = maintenant() - v->arrivee;
+
+	pthread_mutex_lock(&verrou_calendrier);
+	programme(&calendrier_moteur, maintenant() + pause, e);
+	if (calendrier_moteur.tas[0].e == e)
+		pthread_cond_signal(&reveil_minuteur);
+	pthread_mutex_unlock(&verrou_calendrier);
+}
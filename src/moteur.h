@@ -0,0 +1,55 @@
+#ifndef __MOTEUR__
+#define __MOTEUR__
+
+#include <pthread.h>
+#include "project.h"
+#include "calendrier.h"
+#include "reprise.h"
+
+/*! La periode a laquelle le thread principal du moteur verifie si des statistiques ont ete demandees par SIGUSR1 (en microseconde). */
+#define PERIODE_SIGNAUX 100000
+
+/*! Arret de la simulation : aucune voiture n'a progresse depuis DUREE_INTERBLOCAGE. */
+#define INTERBLOCAGE_PROGRESSION 1
+/*! Arret de la simulation : un cycle de cases pleines a ete detecte (voir detecte_interblocage()). */
+#define INTERBLOCAGE_DETECTE 2
+
+/**
+ * \struct FileTaches
+ * \brief Represente la file des voitures pretes d'un thread travailleur.
+ *
+ * Le thread proprietaire depose et reprend ses voitures en queue de file, les autres threads volent en tete de file.
+ */
+typedef struct FileTaches {
+	EtatVoiture **taches;	/*!< Tableau circulaire des voitures pretes. */
+	int debut;	/*!< L'indice de la premiere voiture. */
+	int nombre;	/*!< Le nombre de voitures dans la file. */
+	int capacite;	/*!< La capacite allouee du tableau. */
+	pthread_mutex_t verrou;	/*!< Protege la file. */
+} FileTaches;
+
+void moteur_threads(int nbVoitures);
+
+long long maintenant();
+
+int demande_moteur(Requete *req);
+
+void depose(FileTaches *f, EtatVoiture *e);
+
+EtatVoiture *reprend(FileTaches *f);
+
+EtatVoiture *vole(FileTaches *f);
+
+void rend_prete(int numero, EtatVoiture *e);
+
+void *travailleur(void *arg);
+
+void *minuteur(void *arg);
+
+void *generateur(void *arg);
+
+void termine_moteur();
+
+void accueille_voiture(VoitureReprise *v, int pause);
+
+#endif
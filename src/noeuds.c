@@ -0,0 +1,361 @@
+/**
+ * \file noeuds.c
+ * \brief Contient la simulation repartie sur plusieurs noeuds (option "-n") : partage de la grille, passage des voitures d'un noeud a l'autre par TCP et detection de la fin.
+ *
+ * Chaque noeud est une instance du programme (moteur a base de threads) lancee avec la meme grille, la meme charge et la meme graine, sur la meme machine ou non.
+ * La grille est partagee en bandes de lignes de carrefours consecutives (voir proprietaire()) : chaque noeud simule les carrefours de sa bande, et decide seul de leurs admissions.
+ * Une voiture qui debouche sur un carrefour d'une autre bande est envoyee au noeud proprietaire (voir envoie_voiture()), qui la programme a l'issue de sa pause : elle n'existe jamais que sur un seul noeud.
+ *
+ * Les noeuds sont relies deux a deux par une connexion TCP : le noeud de rang r ecoute sur son port, et se connecte aux noeuds de rang inferieur (qui doivent etre lances, les tentatives sont repetees).
+ * Les messages sont de taille fixe (MessageNoeud), en representation native : les noeuds doivent tourner sur des machines de meme architecture.
+ * Le noeud 0 compte les voitures sorties de la carte sur tous les noeuds, et diffuse la fin de la simulation lorsqu'elles sont toutes sorties.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include "project.h"
+#include "main.h"
+#include "interface.h"
+#include "topologie.h"
+#include "charge.h"
+#include "moteur.h"
+#include "noeuds.h"
+
+int nb_noeuds = 1;
+int rang_noeud = 0;
+char *liste_noeuds = NULL;
+
+/*! Les connexions vers les autres noeuds (-1 pour ce noeud). */
+int sockets_noeuds[MAX_NOEUDS];
+/*! Protegent les envois sur chaque connexion (plusieurs travailleurs peuvent envoyer au meme noeud). */
+pthread_mutex_t verrous_noeuds[MAX_NOEUDS];
+/*! Le nombre de voitures sorties de la carte, tous noeuds confondus (tenu par le noeud 0). */
+int sorties_noeuds;
+/*! Le nombre de voitures recues des autres noeuds. */
+int voitures_recues;
+/*! Le nombre de voitures envoyees aux autres noeuds. */
+int voitures_envoyees;
+
+/**
+ * \fn int proprietaire(int carrefour)
+ * \brief Retourne le noeud qui simule un carrefour : les lignes de la grille sont reparties en nb_noeuds bandes consecutives.
+ *
+ * \param carrefour Le numero du carrefour.
+ *
+ * \return Le rang du noeud proprietaire.
+ */
+int proprietaire(int carrefour)
+{
+	return (carrefour-1) / colonnes * nb_noeuds / lignes;
+}
+
+/**
+ * \fn int connecte_noeud(char *adresse)
+ * \brief Ouvre une connexion TCP vers un noeud, en repetant les tentatives tant qu'il n'ecoute pas (environ 30 secondes).
+ *
+ * \param adresse L'adresse du noeud ("hote:port", modifiee).
+ *
+ * \return La connexion.
+ */
+int connecte_noeud(char *adresse)
+{
+	struct addrinfo indications, *resultat;
+	char *port = strrchr(adresse, ':');
+	int s, essai;
+
+	*port++ = '\0';
+	memset(&indications, 0, sizeof(indications));
+	indications.ai_family = AF_INET;
+	indications.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(adresse, port, &indications, &resultat) != 0) {
+		printf("Noeud %s:%s introuvable.\n", adresse, port);
+		exit(-1);
+	}
+
+	for (essai=0;essai<300;essai++) {
+		s = socket(AF_INET, SOCK_STREAM, 0);
+		if (s == -1)
+			erreurFin("Pb socket noeud");
+		if (connect(s, resultat->ai_addr, resultat->ai_addrlen) == 0) {
+			freeaddrinfo(resultat);
+			return s;
+		}
+		close(s);
+		usleep(100000);
+	}
+
+	printf("Le noeud %s:%s ne repond pas.\n", adresse, port);
+	exit(-1);
+}
+
+/**
+ * \fn void envoie_noeud(int noeud, MessageNoeud *m)
+ * \brief Envoie un message a un noeud.
+ *
+ * Un noeud qui a arrete la simulation sur un interblocage a ferme ses connexions apres avoir diffuse la fin : un message qui lui est encore adresse est abandonne.
+ *
+ * \param noeud Le rang du noeud destinataire.
+ * \param m Pointeur sur le message.
+ */
+void envoie_noeud(int noeud, MessageNoeud *m)
+{
+	char *octets = (char *) m;
+	int envoyes = 0, n;
+
+	pthread_mutex_lock(&verrous_noeuds[noeud]);
+	while (envoyes < sizeof(MessageNoeud)) {
+		n = send(sockets_noeuds[noeud], octets + envoyes, sizeof(MessageNoeud) - envoyes, MSG_NOSIGNAL);
+		if (n == -1 && (errno == EPIPE || errno == ECONNRESET))
+			break;
+		if (n <= 0)
+			erreurFin("Pb envoi noeud");
+		envoyes += n;
+	}
+	pthread_mutex_unlock(&verrous_noeuds[noeud]);
+}
+
+/**
+ * \fn int recoit_noeud(int s, void *tampon, int taille)
+ * \brief Recoit exactement taille octets d'une connexion.
+ *
+ * \param s La connexion.
+ * \param tampon Le tampon a remplir.
+ * \param taille Le nombre d'octets attendus.
+ *
+ * \return 1 si les octets ont ete recus, 0 si la connexion est fermee.
+ */
+int recoit_noeud(int s, void *tampon, int taille)
+{
+	int recus = 0, n;
+
+	while (recus < taille) {
+		n = recv(s, (char *) tampon + recus, taille - recus, 0);
+		if (n <= 0)
+			return 0;
+		recus += n;
+	}
+	return 1;
+}
+
+/**
+ * \fn void connecte_noeuds()
+ * \brief Relie ce noeud a tous les autres (liste_noeuds : "hote:port,hote:port,...", dans l'ordre des rangs).
+ *
+ * Le noeud ecoute sur son adresse (l'hote et le port de son rang dans la liste), se connecte aux noeuds de rang inferieur et accepte les connexions des noeuds de rang superieur ; chaque connexion commence par le rang du noeud qui l'a ouverte.
+ * Quitte le programme si la liste est invalide ou si la grille a moins de lignes que de noeuds.
+ */
+void connecte_noeuds()
+{
+	char *adresses[MAX_NOEUDS], *adresse, *copie, *suite, *hote, *port;
+	struct addrinfo indications, *ecoute;
+	int s, i, j, rang, un = 1;
+
+	copie = strdup(liste_noeuds);
+	nb_noeuds = 0;
+	for (adresse=strtok_r(copie, ",", &suite);adresse != NULL;adresse=strtok_r(NULL, ",", &suite)) {
+		if (nb_noeuds == MAX_NOEUDS || strrchr(adresse, ':') == NULL) {
+			printf("Liste de noeuds invalide : %s (au plus %d adresses hote:port separees par des virgules).\n", liste_noeuds, MAX_NOEUDS);
+			exit(-1);
+		}
+		adresses[nb_noeuds++] = adresse;
+	}
+	if (rang_noeud < 0 || rang_noeud >= nb_noeuds) {
+		printf("Rang de noeud invalide : %d (0 a %d).\n", rang_noeud, nb_noeuds-1);
+		exit(-1);
+	}
+	if (nb_noeuds > lignes) {
+		printf("La grille n'a que %d lignes de carrefours pour %d noeuds.\n", lignes, nb_noeuds);
+		exit(-1);
+	}
+
+	for (i=0;i<nb_noeuds;i++) {
+		sockets_noeuds[i] = -1;
+		pthread_mutex_init(&verrous_noeuds[i], NULL);
+	}
+
+	hote = strdup(adresses[rang_noeud]);
+	port = strrchr(hote, ':');
+	*port++ = '\0';
+	memset(&indications, 0, sizeof(indications));
+	indications.ai_family = AF_INET;
+	indications.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(hote, port, &indications, &ecoute) != 0) {
+		printf("Adresse du noeud %s:%s introuvable.\n", hote, port);
+		exit(-1);
+	}
+	s = socket(AF_INET, SOCK_STREAM, 0);
+	if (s == -1)
+		erreurFin("Pb socket noeud");
+	setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &un, sizeof(un));
+	if (bind(s, ecoute->ai_addr, ecoute->ai_addrlen) == -1 || listen(s, MAX_NOEUDS) == -1)
+		erreurFin("Pb ecoute noeud");
+	freeaddrinfo(ecoute);
+	free(hote);
+
+	for (j=0;j<rang_noeud;j++) {
+		sockets_noeuds[j] = connecte_noeud(adresses[j]);
+		if (send(sockets_noeuds[j], &rang_noeud, sizeof(int), MSG_NOSIGNAL) != sizeof(int))
+			erreurFin("Pb envoi noeud");
+	}
+
+	for (j=rang_noeud+1;j<nb_noeuds;j++) {
+		i = accept(s, NULL, NULL);
+		if (i == -1)
+			erreurFin("Pb accept noeud");
+		if (recoit_noeud(i, &rang, sizeof(int)) == 0 || rang <= rang_noeud || rang >= nb_noeuds || sockets_noeuds[rang] != -1) {
+			printf("Connexion invalide d'un autre noeud.\n");
+			exit(-1);
+		}
+		sockets_noeuds[rang] = i;
+	}
+	close(s);
+
+	for (j=0;j<nb_noeuds;j++)
+		if (j != rang_noeud)
+			setsockopt(sockets_noeuds[j], IPPROTO_TCP, TCP_NODELAY, &un, sizeof(un));
+
+	free(copie);
+}
+
+/**
+ * \fn void annonce_noeud()
+ * \brief Affiche le rang de ce noeud et les carrefours qu'il simule.
+ */
+void annonce_noeud()
+{
+	int i, j;
+
+	for (i=1;i<=nb_carrefours && proprietaire(i) != rang_noeud;i++);
+	for (j=i;j<nb_carrefours && proprietaire(j+1) == rang_noeud;j++);
+	snprintf(buffer, sizeof(buffer), "Noeud %d sur %d : carrefours %d a %d\n", rang_noeud, nb_noeuds, i, j);
+	bilan(buffer);
+}
+
+/**
+ * \fn void compte_sortie_noeuds()
+ * \brief Compte une voiture sortie de la carte (noeud 0) ; la derniere termine la simulation sur tous les noeuds.
+ */
+void compte_sortie_noeuds()
+{
+	if (__atomic_add_fetch(&sorties_noeuds, 1, __ATOMIC_SEQ_CST) < charge_nombre)
+		return;
+
+	arrete_noeuds();
+	termine_moteur();
+}
+
+/**
+ * \fn void arrete_noeuds()
+ * \brief Diffuse la fin de la simulation a tous les autres noeuds : toutes les voitures sont sorties (noeud 0), ou ce noeud est interbloque (voir minuteur()).
+ */
+void arrete_noeuds()
+{
+	MessageNoeud m;
+	int j;
+
+	memset(&m, 0, sizeof(m));
+	m.type = NOEUD_FIN;
+	for (j=0;j<nb_noeuds;j++)
+		if (j != rang_noeud)
+			envoie_noeud(j, &m);
+}
+
+/**
+ * \fn void *recepteur(void *arg)
+ * \brief Fonction realisee par le thread de reception de chaque connexion : programme les voitures recues, compte les sorties (noeud 0), termine la simulation a la reception de la fin.
+ *
+ * \param arg Le rang du noeud a l'autre bout de la connexion.
+ */
+void *recepteur(void *arg)
+{
+	int noeud = (int) (long) arg;
+	MessageNoeud m;
+
+	while (recoit_noeud(sockets_noeuds[noeud], &m, sizeof(m))) {
+		if (m.type == NOEUD_VOITURE) {
+			__atomic_add_fetch(&voitures_recues, 1, __ATOMIC_SEQ_CST);
+			accueille_voiture(&m.voiture, m.pause);
+		} else if (m.type == NOEUD_SORTIE) {
+			compte_sortie_noeuds();
+		} else if (m.type == NOEUD_FIN) {
+			termine_moteur();
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * \fn void demarre_noeuds()
+ * \brief Lance un thread de reception par connexion. A appeler une fois le moteur pret a recevoir des voitures (les messages arrives plus tot attendent dans les connexions).
+ */
+void demarre_noeuds()
+{
+	pthread_t thread;
+	int j;
+
+	for (j=0;j<nb_noeuds;j++) {
+		if (j == rang_noeud)
+			continue;
+		pthread_create(&thread, NULL, recepteur, (void *) (long) j);
+		pthread_detach(thread);
+	}
+}
+
+/**
+ * \fn void envoie_voiture(EtatVoiture *e, int pause)
+ * \brief Envoie une voiture au noeud proprietaire de son prochain carrefour.
+ *
+ * \param e Pointeur sur la voiture, a l'etape ENTREE de son prochain carrefour.
+ * \param pause La pause de la voiture avant son arrivee sur ce carrefour (en microseconde).
+ */
+void envoie_voiture(EtatVoiture *e, int pause)
+{
+	MessageNoeud m;
+
+	memset(&m, 0, sizeof(m));
+	m.type = NOEUD_VOITURE;
+	m.pause = pause;
+	sauve_voiture(&m.voiture, e);
+	m.voiture.arrivee = maintenant() - e->arrivee;
+
+	__atomic_add_fetch(&voitures_envoyees, 1, __ATOMIC_SEQ_CST);
+	envoie_noeud(proprietaire(e->v.carrefour), &m);
+}
+
+/**
+ * \fn void sortie_noeud()
+ * \brief Signale au noeud 0 qu'une voiture de ce noeud a quitte la carte.
+ */
+void sortie_noeud()
+{
+	MessageNoeud m;
+
+	if (rang_noeud == 0) {
+		compte_sortie_noeuds();
+		return;
+	}
+
+	memset(&m, 0, sizeof(m));
+	m.type = NOEUD_SORTIE;
+	envoie_noeud(0, &m);
+}
+
+/**
+ * \fn void bilan_noeud()
+ * \brief Affiche le nombre de voitures echangees avec les autres noeuds.
+ */
+void bilan_noeud()
+{
+	snprintf(buffer, sizeof(buffer), "Noeud %d : %d voitures recues, %d voitures envoyees\n", rang_noeud, voitures_recues, voitures_envoyees);
+	bilan(buffer);
+}
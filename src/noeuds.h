@@ -0,0 +1,50 @@
+#ifndef __NOEUDS__
+#define __NOEUDS__
+
+#include "project.h"
+#include "reprise.h"
+
+/*! Le nombre maximal de noeuds d'une simulation repartie. */
+#define MAX_NOEUDS 64
+
+/*! Message entre noeuds : une voiture passe sur un carrefour du noeud destinataire. */
+#define NOEUD_VOITURE 1
+/*! Message entre noeuds : une voiture a quitte la carte (adresse au noeud 0). */
+#define NOEUD_SORTIE 2
+/*! Message entre noeuds : fin de la simulation (diffuse par le noeud 0 lorsque toutes les voitures ont quitte la carte, ou par un noeud interbloque). */
+#define NOEUD_FIN 3
+
+/**
+ * \struct MessageNoeud
+ * \brief Represente un message entre deux noeuds d'une simulation repartie (72 octets).
+ *
+ * Une voiture passee a un autre noeud y voyage sous la meme forme que dans un point de reprise, sauf sa date d'arrivee, remplacee par la duree deja ecoulee de son trajet (les horloges des noeuds ne sont pas synchronisees).
+ */
+typedef struct MessageNoeud {
+	int type;	/*!< Le type de message (NOEUD_VOITURE, NOEUD_SORTIE ou NOEUD_FIN). */
+	int reserve;	/*!< Reserve, aligne le message. */
+	long long pause;	/*!< La pause de la voiture avant son arrivee sur le carrefour (en microseconde). */
+	VoitureReprise voiture;	/*!< La voiture (NOEUD_VOITURE seulement). */
+} MessageNoeud;
+
+extern int nb_noeuds;	/*!< Le nombre de noeuds de la simulation (1 si elle n'est pas repartie). */
+extern int rang_noeud;	/*!< Le rang de ce noeud (0 a nb_noeuds-1, option "-n"). */
+extern char *liste_noeuds;	/*!< Les adresses des noeuds (option "-n"), NULL si la simulation n'est pas repartie. */
+
+int proprietaire(int carrefour);
+
+void connecte_noeuds();
+
+void annonce_noeud();
+
+void demarre_noeuds();
+
+void envoie_voiture(EtatVoiture *e, int pause);
+
+void sortie_noeud();
+
+void arrete_noeuds();
+
+void bilan_noeud();
+
+#endif
@@ -0,0 +1,67 @@
+#!/bin/sh
+# Lance une simulation repartie (option "-n") sur cette machine et verifie que toutes les voitures sont sorties.
+#
+# Syntaxe : ./noeuds.sh NbNoeuds NbVoitures [options du projet]
+# Exemple : ./noeuds.sh 2 60 -e
+#
+# Chaque noeud ecoute sur 127.0.0.1 (l'hote de son adresse dans la liste), ports PORT a PORT+NbNoeuds-1 (PORT=4700 par defaut).
+# Chaque noeud est lance avec "-t -q", les options donnees et sa sortie dans un fichier temporaire.
+# Le moteur "-t" s'execute en temps reel et s'arrete seul sur un interblocage : aucun delai n'est impose par defaut.
+# Si DELAI est defini, chaque noeud est arrete apres DELAI secondes, en laissant alors ses objets IPC (a supprimer avec ipcrm).
+# Le script affiche le bilan de chaque noeud, puis le total des voitures sorties.
+# Il retourne 0 si tous les noeuds se sont termines normalement et si ce total vaut NbVoitures, 1 sinon.
+
+case "$1$2" in
+	''|*[!0-9]*) set -- ;;
+esac
+if [ $# -lt 2 ] || [ "$1" -lt 1 ]; then
+	echo "Syntaxe : ./noeuds.sh NbNoeuds NbVoitures [options du projet]"
+	exit 1
+fi
+
+noeuds=$1
+voitures=$2
+shift 2
+port=${PORT:-4700}
+delai=${DELAI:-}
+projet=$(dirname "$0")/project
+sorties_dir=$(mktemp -d)
+
+liste=""
+r=0
+while [ $r -lt "$noeuds" ]; do
+	liste="$liste${liste:+,}127.0.0.1:$((port + r))"
+	r=$((r + 1))
+done
+
+# Les noeuds de rang superieur se connectent a ceux de rang inferieur, en repetant leurs tentatives : l'ordre de lancement est libre.
+pids=""
+r=0
+while [ $r -lt "$noeuds" ]; do
+	(${delai:+timeout "$delai"} "$projet" -t -q "$@" -n $r "$liste" "$voitures" > "$sorties_dir/noeud$r" 2>&1; echo $? > "$sorties_dir/code$r") &
+	pids="$pids $!"
+	r=$((r + 1))
+done
+wait $pids
+
+total=0
+echec=0
+r=0
+while [ $r -lt "$noeuds" ]; do
+	code=$(cat "$sorties_dir/code$r")
+	sorties=$(sed -n 's/^\([0-9]*\) Voitures sont sorties$/\1/p' "$sorties_dir/noeud$r" | tail -n 1)
+	echo "Noeud $r : code $code, ${sorties:-0} voitures sorties"
+	if [ "$code" -ne 0 ]; then
+		echec=1
+		sed 's/^/    /' "$sorties_dir/noeud$r"
+	fi
+	total=$((total + ${sorties:-0}))
+	r=$((r + 1))
+done
+rm -rf "$sorties_dir"
+
+echo "Total : $total voitures sorties sur $voitures"
+if [ $echec -ne 0 ] || [ $total -ne "$voitures" ]; then
+	exit 1
+fi
+exit 0
@@ -0,0 +1,159 @@
+/**
+ * \file occupation.c
+ * \brief Contient les indicateurs de congestion de la grille (vehicules en file, croisements occupes, croisement le plus charge), calcules par des noyaux vectoriels.
+ *
+ * Dans le segment des carrefours, chaque croisement occupe sa propre ligne de cache (voir Croisement) : c'est ce qui convient aux decisions, qui modifient un croisement a la fois, mais un parcours de toute la grille ne lit alors qu'un entier par ligne de cache.
+ * Les indicateurs sont donc calcules sur un releve rang par rang (Occupation) : un tableau contigu par compteur, ou un seul vecteur couvre 8 croisements.
+ * Le releve est une copie : le segment garde sa disposition, et les decisions et leurs operations atomiques sont inchangees.
+ *
+ * Les noyaux sont compiles deux fois (AVX2 et generique) ; la version est choisie au chargement du programme selon le processeur.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "project.h"
+#include "occupation.h"
+
+/**
+ * \fn void initialise_occupation(Occupation *o, int nombre)
+ * \brief Alloue les tableaux d'un releve (alignes sur un vecteur) et les remet a zero.
+ *
+ * \param o Pointeur sur le releve.
+ * \param nombre Le nombre de carrefours.
+ */
+void initialise_occupation(Occupation *o, int nombre)
+{
+	size_t taille = (size_t) nombre * PAS_OCCUPATION * sizeof(int);
+
+	o->nb_carrefours = nombre;
+	o->etat = aligned_alloc(sizeof(Vecteur), taille);
+	o->avantH = aligned_alloc(sizeof(Vecteur), taille);
+	o->apresH = aligned_alloc(sizeof(Vecteur), taille);
+	o->avantV = aligned_alloc(sizeof(Vecteur), taille);
+	o->apresV = aligned_alloc(sizeof(Vecteur), taille);
+	if (o->etat == NULL || o->avantH == NULL || o->apresH == NULL || o->avantV == NULL || o->apresV == NULL) {
+		perror("Pb malloc occupation");
+		exit(1);
+	}
+
+	memset(o->etat, 0, taille);
+	memset(o->avantH, 0, taille);
+	memset(o->apresH, 0, taille);
+	memset(o->avantV, 0, taille);
+	memset(o->apresV, 0, taille);
+}
+
+/**
+ * \fn void detruit_occupation(Occupation *o)
+ * \brief Libere les tableaux d'un releve.
+ *
+ * \param o Pointeur sur le releve.
+ */
+void detruit_occupation(Occupation *o)
+{
+	free(o->etat);
+	free(o->avantH);
+	free(o->apresH);
+	free(o->avantV);
+	free(o->apresV);
+	o->nb_carrefours = 0;
+}
+
+/**
+ * \fn void releve_occupation(Occupation *o, Carrefour *reseau)
+ * \brief Copie les compteurs de tous les croisements de la grille dans un releve.
+ *
+ * Les compteurs sont lus un a un, sans verrou : le releve est coherent croisement par croisement, pas pour toute la grille.
+ *
+ * \param o Pointeur sur le releve (initialise pour le nombre de carrefours de la grille).
+ * \param reseau Les carrefours.
+ */
+void releve_occupation(Occupation *o, Carrefour *reseau)
+{
+	Croisement *x;
+	int c, k, i;
+
+	for (c=0;c<o->nb_carrefours;c++) {
+		for (k=0;k<25;k++) {
+			x = &reseau[c].croisements[k];
+			i = c*PAS_OCCUPATION + k;
+			o->etat[i] = __atomic_load_n(&x->etat, __ATOMIC_RELAXED);
+			o->avantH[i] = __atomic_load_n(&x->avantH, __ATOMIC_RELAXED);
+			o->apresH[i] = __atomic_load_n(&x->apresH, __ATOMIC_RELAXED);
+			o->avantV[i] = __atomic_load_n(&x->avantV, __ATOMIC_RELAXED);
+			o->apresV[i] = __atomic_load_n(&x->apresV, __ATOMIC_RELAXED);
+		}
+	}
+}
+
+/**
+ * \fn void metriques_plage(Occupation *o, int debut, int fin, Metriques *m)
+ * \brief Calcule les indicateurs de congestion d'une plage de croisements du releve, LARGEUR_VECTEUR croisements a la fois.
+ *
+ * Chaque voie du vecteur tient ses propres sommes et son propre maximum (valeur et indice) ; les voies ne sont reunies qu'a la fin.
+ *
+ * \param o Pointeur sur le releve.
+ * \param debut L'indice du premier croisement (multiple de LARGEUR_VECTEUR).
+ * \param fin L'indice qui suit le dernier croisement (multiple de LARGEUR_VECTEUR).
+ * \param m Pointeur sur les indicateurs a renseigner.
+ */
+__attribute__((target_clones("avx2", "default")))
+void metriques_plage(Occupation *o, int debut, int fin, Metriques *m)
+{
+	Vecteur avant = {0}, apres = {0}, occupes = {0}, max = {0}, indice_max = {0}, indices = {0, 1, 2, 3, 4, 5, 6, 7};
+	Vecteur charge, plus;
+	int i;
+
+	indices += debut;
+	indice_max -= 1;
+
+	for (i=debut;i<fin;i+=LARGEUR_VECTEUR) {
+		charge = *(Vecteur *) &o->avantH[i] + *(Vecteur *) &o->avantV[i];
+		avant += charge;
+		apres += *(Vecteur *) &o->apresH[i] + *(Vecteur *) &o->apresV[i];
+		occupes -= *(Vecteur *) &o->etat[i] == 1;
+
+		plus = charge > max;
+		max = (charge & plus) | (max & ~plus);
+		indice_max = (indices & plus) | (indice_max & ~plus);
+		indices += LARGEUR_VECTEUR;
+	}
+
+	m->avant = m->apres = 0;
+	m->occupes = m->charge_max = 0;
+	m->plus_charge = -1;
+	for (i=0;i<LARGEUR_VECTEUR;i++) {
+		m->avant += avant[i];
+		m->apres += apres[i];
+		m->occupes += occupes[i];
+		if (max[i] > m->charge_max || (max[i] == m->charge_max && max[i] > 0 && indice_max[i] < m->plus_charge)) {
+			m->charge_max = max[i];
+			m->plus_charge = indice_max[i];
+		}
+	}
+}
+
+/**
+ * \fn void metriques_reseau(Occupation *o, Metriques *m)
+ * \brief Calcule les indicateurs de congestion de toute la grille.
+ *
+ * \param o Pointeur sur le releve.
+ * \param m Pointeur sur les indicateurs a renseigner.
+ */
+void metriques_reseau(Occupation *o, Metriques *m)
+{
+	metriques_plage(o, 0, o->nb_carrefours * PAS_OCCUPATION, m);
+}
+
+/**
+ * \fn void metriques_carrefour(Occupation *o, int carrefour, Metriques *m)
+ * \brief Calcule les indicateurs de congestion d'un carrefour.
+ *
+ * \param o Pointeur sur le releve.
+ * \param carrefour Le numero du carrefour (a partir de 1).
+ * \param m Pointeur sur les indicateurs a renseigner.
+ */
+void metriques_carrefour(Occupation *o, int carrefour, Metriques *m)
+{
+	metriques_plage(o, (carrefour-1) * PAS_OCCUPATION, carrefour * PAS_OCCUPATION, m);
+}
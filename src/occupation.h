@@ -0,0 +1,53 @@
+#ifndef __OCCUPATION__
+#define __OCCUPATION__
+
+#include "project.h"
+
+/*! Le nombre de places reservees a chaque carrefour dans les tableaux de l'occupation : ses 25 croisements et 7 places vides, soit 4 vecteurs. */
+#define PAS_OCCUPATION 32
+/*! Le nombre d'entiers d'un vecteur des noyaux de calcul (256 bits). */
+#define LARGEUR_VECTEUR 8
+
+/*! Un vecteur de LARGEUR_VECTEUR entiers (extension vectorielle de gcc, compilee en instructions SIMD). */
+typedef int Vecteur __attribute__((vector_size(LARGEUR_VECTEUR * sizeof(int))));
+
+/**
+ * \struct Occupation
+ * \brief Represente un releve des compteurs de tous les croisements de la grille, rang par rang (un tableau contigu par compteur).
+ *
+ * Le croisement k du carrefour c (a partir de 0) est a l'indice c*PAS_OCCUPATION+k de chaque tableau ; les places vides valent 0.
+ */
+typedef struct Occupation {
+	int nb_carrefours;	/*!< Le nombre de carrefours releves. */
+	int *etat;	/*!< L'etat des croisements (-1 inutile, 0 libre, 1 traverse). */
+	int *avantH;	/*!< Les files avant les croisements horizontaux. */
+	int *apresH;	/*!< Les files apres les croisements horizontaux. */
+	int *avantV;	/*!< Les files avant les croisements verticaux. */
+	int *apresV;	/*!< Les files apres les croisements verticaux. */
+} Occupation;
+
+/**
+ * \struct Metriques
+ * \brief Represente les indicateurs de congestion d'un ensemble de croisements.
+ */
+typedef struct Metriques {
+	long long avant;	/*!< Le nombre de vehicules dans les files avant les croisements. */
+	long long apres;	/*!< Le nombre de vehicules dans les files apres les croisements. */
+	int occupes;	/*!< Le nombre de croisements en cours de traversee. */
+	int charge_max;	/*!< La plus longue attente avant un croisement (avantH + avantV). */
+	int plus_charge;	/*!< L'indice (c*PAS_OCCUPATION+k) du croisement le plus charge, -1 si aucune file n'est occupee. */
+} Metriques;
+
+void initialise_occupation(Occupation *o, int nombre);
+
+void detruit_occupation(Occupation *o);
+
+void releve_occupation(Occupation *o, Carrefour *reseau);
+
+void metriques_plage(Occupation *o, int debut, int fin, Metriques *m);
+
+void metriques_reseau(Occupation *o, Metriques *m);
+
+void metriques_carrefour(Occupation *o, int carrefour, Metriques *m);
+
+#endif
@@ -5,16 +5,24 @@
 #ifndef __PROJECT__
 #define __PROJECT__
 
-/*! Le numero du semaphore utilise pour les operations de synchronisation. */
+/*! Le numero du semaphore utilise pour les operations de synchronisation du compteur de voitures sorties (l'affichage passe par le journal, sans verrou). */
 #define MUTEX 1
+/*! Le numero du premier semaphore de croisement. Chaque croisement de chaque carrefour possede son propre semaphore (voir sem_croisement()). */
+#define SEM_CROISEMENTS 2
 
-/*! La duree maximale des differentes operations des voitures (traversement des croisements, arrivees dans les files, etc) en microseconde. */
+/*! La duree maximale des differentes operations des voitures (traversement des croisements, arrivees dans les files, etc) en microseconde. Redefinissable a la compilation (-DMAXPAUSE=...). */
+#ifndef MAXPAUSE
 #define MAXPAUSE 1000000
-/*! La duree minimale des differentes operations des voitures (traversement des croisements, arrivees dans les files, etc) en microseconde. */
+#endif
+/*! La duree minimale des differentes operations des voitures (traversement des croisements, arrivees dans les files, etc) en microseconde. Redefinissable a la compilation (-DMINPAUSE=...). */
+#ifndef MINPAUSE
 #define MINPAUSE 1000
+#endif
 
-/*! Le nombre maximum de voitures dans les files avant / apres les croisements. Dimensionne le carrefour. */
+/*! Le nombre maximum de voitures dans les files avant / apres les croisements. Dimensionne le carrefour. Redefinissable a la compilation (-DMAXFILE=...). */
+#ifndef MAXFILE
 #define MAXFILE 1
+#endif
 
 /*! Represente un message d'information d'arrivee sur un carrefour. */
 #define MESSARRIVE 1
@@ -24,6 +32,10 @@
 #define MESSINFO 3
 /*! Represente un message d'information de sortie d'un carrefour. */
 #define MESSSORT 4
+/*! Represente la decision du serveur sur une demande, renvoyee au carrefour dans sa file (voir encode_decision()). */
+#define MESSDECISION 5
+/*! Represente une demande d'engagement d'une voiture sur sa voie d'un carrefour, en un seul message (option "-p", voir reserve_parcours()). */
+#define MESSRESERVE 6
 
 /*! Represente la position avant un croisement (la file de voitures avant). */
 #define AVANT 1
@@ -32,23 +44,71 @@
 /*! Represente la position avant un croisement (la file de voitures apres). */
 #define APRES 3
 
+/*! Represente l'etape d'arrivee d'une voiture sur un carrefour, avant le premier croisement (moteurs sans processus par voiture). */
+#define ENTREE 0
+/*! Represente l'etape de sortie d'une voiture d'un carrefour, apres le dernier croisement (moteurs sans processus par voiture). */
+#define SORTIE 4
+
+/*! Valeur retournee par etape_voiture() lorsque la voiture a quitte la carte. */
+#define FIN -1
+
+/*! Le moteur historique : un processus par voiture, un processus par carrefour et un processus serveur. */
+#define MOTEUR_PROCESSUS 0
+/*! Le moteur a base de threads : les voitures sont des etats ordonnances sur un ensemble fixe de threads. */
+#define MOTEUR_THREADS 1
+/*! Le moteur a evenements discrets : un seul processus, temps virtuel, resultats reproductibles. */
+#define MOTEUR_EVENEMENTS 2
+
+/*! Les decisions d'admission sont prises par le serveur, sur demande des carrefours (comportement historique). */
+#define ADMISSION_SERVEUR 0
+/*! Les voitures reservent directement leurs places dans le segment du carrefour par compare-and-swap, sans passer par le serveur. */
+#define ADMISSION_ATOMIQUE 1
+/*! Chaque carrefour prend ses decisions d'admission lui meme, dans son segment, sans passer par le serveur ni par les semaphores (MOTEUR_PROCESSUS). */
+#define ADMISSION_LOCALE 2
+
+/*! Ordre d'admission historique : une place liberee revient a la premiere demande (re)examinee, quel que soit son anciennete. */
+#define ORDRE_LIBRE 0
+/*! Ordre d'admission par tickets (option "-f") : les demandes sur une meme case d'un croisement sont accordees dans leur ordre d'arrivee (voir prend_ticket()). */
+#define ORDRE_TICKETS 1
+
+/*! La taille d'une ligne de cache. Chaque croisement est aligne sur une ligne pour eviter le faux partage entre voitures de croisements differents. */
+#define TAILLE_LIGNE_CACHE 64
+
 /*! Represente l'orientation horizontale d'un croisement (les files avant et apres selon l'axe horizontal). */
 #define HO 0
 /*! Represente l'orientation verticale d'un croisement (les files avant et apres selon l'axe vertical). */
 #define VE 1
 
+/*! Represente la sortie nord d'un carrefour (vers la ligne precedente de la grille). Une voie v sort dans la direction (v-1)%4. */
+#define NORD 0
+/*! Represente la sortie est d'un carrefour (vers la colonne suivante de la grille). */
+#define EST 1
+/*! Represente la sortie sud d'un carrefour (vers la ligne suivante de la grille). */
+#define SUD 2
+/*! Represente la sortie ouest d'un carrefour (vers la colonne precedente de la grille). */
+#define OUEST 3
+
+/**
+ * \struct Passage
+ * \brief Represente le passage d'une voie sur un croisement (une section critique).
+ */
+typedef struct Passage {
+	int croisement;	/*!< L'indice du croisement (0<=croisement<25). */
+	int voie;	/*!< Le numero de la voie croisee a cet endroit. */
+	int orientation;	/*!< L'orientation du croisement (horizontal / vertical). */
+} Passage;
+
 /**
  * \struct Voie
  * \brief Represente une voie d'un carrefour.
  *
  * Une voie d'un carrefour est caracterisee par un numero (de 1 a 12).
- * Chaque voie possede un maximum de 6 sections critiques representant les intersections (et donc collisions possibles) avec les autres voies : les croisements.
+ * Ses sections critiques (les intersections, et donc collisions possibles, avec les autres voies : les croisements) sont consecutives dans le tableau plat passages[], dans l'ordre de parcours.
  */
 typedef struct Voie {
 	int numero;	/*!< Le numero de la voie. */
-	int sem_num[6];	/*!< Les indices des croisements avec les autres voies (si la voie possede moins de 6 intersections, le premier indice "vide" vaut -1) */
-	int croisements[6];	/*!< Les numeros des voies croisees au niveau des indices de croisements respectifs (si la voie possede moins de 6 intersections, le premier numero "vide" vaut -1) */
-	int orientation[6];	/*!< Les orientations des croisements respectifs (horizontal / vertical) */
+	int premier;	/*!< L'indice du premier passage de la voie dans passages[]. */
+	int nombre;	/*!< Le nombre de passages de la voie (0 si elle ne croise aucune autre voie). */
 } Voie;
 
 /**
@@ -66,6 +126,10 @@ typedef struct Voie {
  *  - -1 : Le croisement est inutile car ne croise aucune autre voie (utilise uniquement a des fins d'affichage).
  *  - 0 : Personne n'est en train de traverser le croisement.
  *  - 1 : Quelqu'un est en train de traverser le croisement.
+ *
+ * En ordre par tickets (option "-f"), chaque case du croisement (numerotee par CASE_AVANTH a CASE_APRESV, voir interblocage.h) distribue des tickets aux demandes qui la visent et sert le ticket le plus ancien.
+ *
+ * Chaque croisement occupe sa propre ligne de cache (voir TAILLE_LIGNE_CACHE).
  */
 typedef struct Croisement {
 	int etat;	/*!< L'etat du croisement. */
@@ -73,7 +137,10 @@ typedef struct Croisement {
 	int apresH;	/*!< Le nombre de vehicules en attente apres le croisement horizontal. */
 	int avantV;	/*!< Le nombre de vehicules en attente avant le croisement vertical. */
 	int apresV;	/*!< Le nombre de vehicules en attente apres le croisement vertical. */
-} Croisement;
+	int occupant;	/*!< L'orientation (HO / VE) de la voiture qui traverse le croisement, valable si etat vaut 1 (voir interblocage.c). */
+	int tickets[5];	/*!< Le prochain ticket distribue par chaque case du croisement. */
+	int servis[5];	/*!< Le ticket servi par chaque case : seule la demande qui le porte peut y etre accordee. */
+} __attribute__((aligned(TAILLE_LIGNE_CACHE))) Croisement;
 
 /**
  * \struct Voiture
@@ -82,7 +149,7 @@ typedef struct Croisement {
  * Une voiture est caracterisee par :
  * - Un numero
  * - Une voie qui lui est attribuee et qu'elle suivra depuis son entree dans le carrefour jusqu'a sa sortie (1<=voie<=12).
- * - Un carrefour sur lequel elle se trouve (1<=carrefour<=4).
+ * - Un carrefour sur lequel elle se trouve (1<=carrefour<=nb_carrefours).
  */
 typedef struct Voiture {
 	int numero;	/*!< Le numero de la voiture. */
@@ -90,6 +157,40 @@ typedef struct Voiture {
 	int carrefour;	/*!< Le carrefour ou se trouve la voiture. */
 } Voiture;
 
+/**
+ * \struct Alea
+ * \brief Represente le flux aleatoire d'une voiture (generateur a compteur, voir alea.c).
+ *
+ * Le n-ieme nombre du flux est obtenu en melangeant la cle et le compteur : il est reproductible quels que soient le moteur et l'ordre d'execution des voitures.
+ */
+typedef struct Alea {
+	unsigned long long cle;	/*!< La cle du flux, derivee de la graine globale et du numero de la voiture. */
+	unsigned long long compteur;	/*!< Le nombre de tirages deja effectues. */
+} Alea;
+
+/**
+ * \struct EtatVoiture
+ * \brief Represente l'etat d'avancement d'une voiture, pour les moteurs qui n'utilisent pas un processus par voiture.
+ *
+ * Un etat de voiture est caracterise par :
+ * - La voiture elle meme (numero, voie et carrefour courants).
+ * - L'indice du croisement courant dans la voie (0<=indice<6).
+ * - L'etape courante sur ce croisement. Peut valoir :
+ *  - ENTREE : la voiture arrive sur le carrefour.
+ *  - AVANT, PENDANT, APRES : la voiture demande a entrer dans la zone correspondante du croisement courant.
+ *  - SORTIE : la voiture quitte le carrefour.
+ * - Le flux aleatoire propre a la voiture (remplace srand/rand, partages entre threads).
+ */
+typedef struct EtatVoiture {
+	Voiture v;	/*!< La voiture. */
+	int indice;	/*!< L'indice du croisement courant dans la voie. */
+	int etape;	/*!< L'etape courante (ENTREE, AVANT, PENDANT, APRES ou SORTIE). */
+	Alea alea;	/*!< Le flux aleatoire de la voiture. */
+	long long arrivee;	/*!< La date d'arrivee de la voiture sur la carte (en microseconde), pour la mesure de la duree de son trajet. */
+	long long demande;	/*!< La date de la premiere emission de la demande en cours (en microseconde), -1 si aucune demande n'est en cours. */
+	int ticket;	/*!< Le ticket de la demande en cours en ordre par tickets (voir prend_ticket()), -1 si aucun. */
+} EtatVoiture;
+
 /**
  * \struct Requete
  * \brief Represente une requete du client pour le serveur (d'une voiture pour un carrefour / le serveur).
@@ -101,7 +202,7 @@ typedef struct Voiture {
  *  - MESSINFO : message d'information d'arrivee avant, pendant, ou apres un croisement. N'implique aucun traitement, affiche juste l'information.
  *  - MESSSORT : message d'information de sortie d'un carrefour. Implique de mettre a jour la file d'attente "apres" le croisement precedent.
  * - Le pid du processus qui emet la requete (la voiture si entre voiture-carrefour, le carrefour si entre carrefour-serveur).
- * - Une copie de la voiture qui emet la requete.
+ * - Le numero de la voiture qui emet la requete.
  * - L'indice du croisement ou se trouve la voiture.
  * - Le numero de la voie, selon le cas :
  *  - ou se trouve la voiture (pour les informations d'entree / sortie de carrefour)
@@ -112,11 +213,13 @@ typedef struct Voiture {
  *  - PENDANT
  *  - APRES
  *  - -1 si inaproprié (arrivee / sortie d'un carrefour => pas de croisement)
+ *
+ * Dans les files de message, une requete circule encodee dans un Message (voir encode_requete()).
  */
 typedef struct {
 	long  type;	/*!< Le type de message. */
 	pid_t pidEmetteur;	/*!< Le pid du processus emetteur. */
-	Voiture v;	/*!< La copie de la voiture qui emet la requete. */
+	int voiture;	/*!< Le numero de la voiture qui emet la requete. */
 	int carrefour;	/*!< Numero du carrefour ou se trouve la voiture effectuant la requete. */
 	int croisement;	/*!< L'indice du croisement ou se trouve la voiture. */
 	int croisement_orientation;	/*!< L'orientation (horizontal / vertical) du croisement. */
@@ -124,6 +227,7 @@ typedef struct {
 	int croisement_precedent_orientation;	/*!< L'orientation (horizontal / vertical) du croisement precedent. */
 	int voie;	/*!< Le numero de la voie. */
 	int traverse;	/*!< L'etat de traversement du croisement. */
+	int ticket;	/*!< Le ticket de la demande dans la case qu'elle vise (ordre par tickets), -1 si elle n'en a pas. Ne circule pas dans les files de message. */
 } Requete;
 
 /**
@@ -139,27 +243,50 @@ typedef struct {
 typedef struct {
 	long  type;	/*!< Le type de message. */
 	int autorisation;	/*!< La reponse a la requete. */
-	Voiture v;	/*!< Variable necessaire pour eviter un plantage (explication a trouver). */
 } Reponse;
 
+/**
+ * \struct Message
+ * \brief Represente une requete encodee pour les files de message : 2 mots de 64 bits (voir message.c pour le format).
+ */
+typedef struct {
+	long  type;	/*!< Le type de message (type de requete, ou pid du destinataire). */
+	unsigned long long mots[2];	/*!< La requete encodee (version, voiture, carrefour, croisements, voie, traversement). */
+} Message;
+
 /**
  * \struct Carrefour
  * \brief Represente un carrefour.
  *
  * Un carrefour est caracterise par 25 croisements.
  * 5 croisements sont "inutiles" car ne croisent aucune autre voie (N°2, 10, 12, 14 et 22), mais gardes par soucis de simplicite d'affichage.
+ * Avec le controleur de feux (option "-c"), la phase verte du carrefour et sa date de debut tiennent dans un seul mot (voir feux.c).
+ * En reservation de parcours (option "-p"), l'occupation du carrefour tient dans un seul mot : le nombre de voitures engagees sur chaque voie et les voies dont une reservation a ete refusee (voir reserve_parcours()).
  */
 typedef struct Carrefour {
 	Croisement croisements[25];	/*!< Les 25 croisements du carrefour. */
+	unsigned long long occupation;	/*!< L'occupation en reservation de parcours : voitures engagees par voie (COMPTEUR_PARCOURS()) et voies en attente (ATTENTE_PARCOURS()). */
+	unsigned long long feu;	/*!< Le feu du carrefour : sa phase (bits 0 a 3), l'indicateur de degagement (bit 4) et la date de debut (bits suivants, voir MOT_FEU()). */
 } Carrefour;
 
-extern int tailleReq;	/*!< La taille d'une requete. */
+extern int tailleReq;	/*!< La taille d'une requete dans une file de message (sizeof(Message) sans le type). */
 extern int tailleRep;	/*!< La taille d'une reponse. */
 
 extern int msg_serveur;	/*!< La file de message utilisee pour communiquer entre le serveur et les carrefour. */
-extern int msg_carrefour[];	/*!< Les files de message utilisees pour communiquer entre les voitures et les carrefour (4 files). */
-extern int carrefours[];	/*!< Les 4 carrefours accessibles par les autres processus en tant que segments de memoire partagee. */
-extern int sem;	/*!< L'identifiant de l'ensemble de semaphores (1 semaphore). */
+extern int *msg_carrefour;	/*!< Les files de message utilisees pour communiquer entre les voitures et les carrefour (nb_carrefours files). */
+extern int carrefours;	/*!< Le segment de memoire partagee des carrefours (nb_carrefours carrefours consecutifs). */
+extern Carrefour *reseau;	/*!< Les carrefours, attaches une seule fois avant les fork (reseau[numero-1]). */
+extern int nb_carrefours;	/*!< Le nombre de carrefours de la grille. */
+extern int sem;	/*!< Le segment de memoire partagee des semaphores (nb_semaphores verrous, voir sem.c). */
+extern int nb_semaphores;	/*!< Le nombre de semaphores : MUTEX puis, en MOTEUR_PROCESSUS seulement, 1 semaphore par croisement de chaque carrefour (fixe une fois le moteur et la grille connus). */
 extern int compteur;	/*!< Le compteur de voitures sorties, accessible par les autres processus en tant que segment de memoire partagee. */
+extern int nb_threads;	/*!< Le nombre de threads travailleurs du moteur MOTEUR_THREADS (0 : 1 par coeur). */
+extern int admission;	/*!< Le mode d'admission choisi au lancement (ADMISSION_SERVEUR, ADMISSION_ATOMIQUE ou ADMISSION_LOCALE). */
+extern int evitement;	/*!< Vaut 1 si les demandes qui meneraient a un interblocage sont refusees (option "-e", voir etat_sur()), 0 sinon. */
+extern int ordre;	/*!< L'ordre d'admission des demandes en attente (ORDRE_LIBRE ou ORDRE_TICKETS, option "-f"). */
+extern int feux;	/*!< Vaut 1 si les lignes d'arret des carrefours sont reglees par des feux a phases adaptatives (option "-c", voir feux.c), 0 sinon. */
+extern int reservation;	/*!< Vaut 1 si les voitures reservent tous les croisements de leur voie en une seule demande (option "-p"), 0 sinon. */
+extern unsigned long long graine_globale;	/*!< La graine dont derivent les flux aleatoires de toutes les voitures (option "-s"). */
+extern int moteur;	/*!< Le moteur de simulation choisi au lancement (MOTEUR_PROCESSUS, MOTEUR_THREADS ou MOTEUR_EVENEMENTS). */
 
 #endif
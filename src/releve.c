@@ -0,0 +1,65 @@
+/**
+ * \file releve.c
+ * \brief Programme annexe : affiche les statistiques d'attente des croisements d'une simulation en cours.
+ *
+ * Syntaxe : "./releve segment" (un releve) ou "./releve segment periode" (un releve toutes les periode secondes, jusqu'a la fin de la simulation).
+ * Le numero du segment est affiche au lancement de la simulation ("Statistiques : segment N"). Le segment est attache en lecture seule.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/types.h>
+#include "project.h"
+#include "statistiques.h"
+
+/**
+ * \fn int main(int argc, char* argv[])
+ * \brief Attache le segment des statistiques en lecture seule et l'affiche, une fois ou periodiquement.
+ */
+int main(int argc, char* argv[])
+{
+	Statistiques *s;
+	struct shmid_ds infos;
+	int segment, periode = 0;
+
+	if (argc != 2 && argc != 3) {
+		printf("Syntaxe : ""./releve segment"" OU ""./releve segment periode"".\n");
+		exit(-1);
+	}
+
+	segment = atoi(argv[1]);
+	if (argc == 3)
+		periode = atoi(argv[2]);
+
+	if (shmctl(segment, IPC_STAT, &infos) == -1 || infos.shm_segsz < sizeof(Statistiques)) {
+		printf("%s n'est pas un segment de statistiques.\n", argv[1]);
+		exit(-1);
+	}
+
+	s = shmat(segment, NULL, SHM_RDONLY);
+	if (s == (void *) -1) {
+		perror("Pb shmat statistiques");
+		exit(1);
+	}
+
+	if (infos.shm_segsz != TAILLE_STATISTIQUES(s->nb_carrefours)) {
+		printf("%s n'est pas un segment de statistiques.\n", argv[1]);
+		exit(-1);
+	}
+
+	affiche_statistiques(s, stdout);
+
+	while (periode > 0) {
+		sleep(periode);
+		/* La simulation a supprime le segment : il n'est plus attache que par ce programme. */
+		if (shmctl(segment, IPC_STAT, &infos) == -1 || infos.shm_nattch <= 1)
+			break;
+		printf("\n");
+		affiche_statistiques(s, stdout);
+	}
+
+	shmdt(s);
+	return 0;
+}
@@ -0,0 +1,119 @@
+/**
+ * \file rendu.c
+ * \brief Programme annexe : relit une trace binaire (option "-T" du projet) et produit l'affichage en colonnes ou un fichier CSV.
+ *
+ * Syntaxe : "./rendu fichier" (affichage en colonnes, identique a celui de la simulation) ou "./rendu -csv fichier".
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "project.h"
+#include "interface.h"
+#include "client.h"
+#include "trace.h"
+
+void rendu_colonnes(EvenementTrace *e);
+
+void rendu_csv(EvenementTrace *e);
+
+/**
+ * \fn int main(int argc, char* argv[])
+ * \brief Ouvre et verifie la trace, puis affiche chacun de ses evenements dans l'ordre d'enregistrement.
+ */
+int main(int argc, char* argv[])
+{
+	EnteteTrace *entete;
+	EvenementTrace *evenements;
+	struct stat infos;
+	long long i, nombre;
+	int fd, csv = 0;
+	char *chemin;
+
+	if (argc == 3 && strcmp(argv[1], "-csv") == 0) {
+		csv = 1;
+		chemin = argv[2];
+	} else if (argc == 2) {
+		chemin = argv[1];
+	} else {
+		printf("Syntaxe : ""./rendu fichier"" OU ""./rendu -csv fichier"".\n");
+		exit(-1);
+	}
+
+	fd = open(chemin, O_RDONLY);
+	if (fd == -1 || fstat(fd, &infos) == -1 || infos.st_size < sizeof(EnteteTrace)) {
+		perror("Pb ouverture trace");
+		exit(1);
+	}
+
+	entete = mmap(NULL, infos.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (entete == MAP_FAILED) {
+		perror("Pb mmap trace");
+		exit(1);
+	}
+
+	if (memcmp(entete->magique, MAGIQUE_TRACE, 8) != 0 || entete->version != VERSION_TRACE || entete->taille != sizeof(EvenementTrace)) {
+		printf("%s n'est pas une trace compatible (version %d attendue).\n", chemin, VERSION_TRACE);
+		exit(1);
+	}
+
+	evenements = (EvenementTrace *) (entete + 1);
+	nombre = (infos.st_size - sizeof(EnteteTrace)) / sizeof(EvenementTrace);
+	if (entete->nombre < nombre)
+		nombre = entete->nombre;
+
+	if (csv)
+		printf("date_us,voiture,carrefour,croisement,orientation,traverse,type,autorisation,voie\n");
+
+	for (i=0;i<nombre;i++) {
+		if (csv)
+			rendu_csv(&evenements[i]);
+		else
+			rendu_colonnes(&evenements[i]);
+	}
+
+	if (entete->perdus > 0)
+		fprintf(stderr, "%lld evenements perdus (fichier de trace impossible a agrandir).\n", entete->perdus);
+
+	munmap(entete, infos.st_size);
+	close(fd);
+	return 0;
+}
+
+/**
+ * \fn void rendu_colonnes(EvenementTrace *e)
+ * \brief Affiche un evenement dans la colonne de sa voiture.
+ *
+ * Les requetes et les reponses sont affichees par les memes fonctions que pendant la simulation (affichageRequete() et affichageAutorisation()).
+ *
+ * \param e Pointeur sur l'evenement.
+ */
+void rendu_colonnes(EvenementTrace *e)
+{
+	Requete req;
+	Voiture v;
+
+	v.numero = e->voiture;
+	v.voie = NULL;
+	v.carrefour = e->carrefour;
+
+	constructionRequete(&req, &v, e->carrefour, -1, -1, e->croisement, e->orientation, e->voie, e->traverse, e->type);
+	if (e->autorisation == -1)
+		affichageRequete(&req);
+	else
+		affichageAutorisation(&req, e->autorisation);
+}
+
+/**
+ * \fn void rendu_csv(EvenementTrace *e)
+ * \brief Affiche un evenement sous forme d'une ligne CSV.
+ *
+ * \param e Pointeur sur l'evenement.
+ */
+void rendu_csv(EvenementTrace *e)
+{
+	printf("%lld,%d,%d,%d,%d,%d,%d,%d,%d\n", e->date, e->voiture, e->carrefour, e->croisement, e->orientation, e->traverse, e->type, e->autorisation, e->voie);
+}
@@ -0,0 +1,274 @@
+/**
+ * \file reprise.c
+ * \brief Contient les points de reprise du moteur a evenements discrets : ecriture de l'etat complet de la simulation (option "-k") et reprise depuis ce fichier (option "-K").
+ *
+ * Entre deux evenements, l'etat du moteur a evenements discrets est entierement en memoire dans un seul processus : les compteurs des carrefours, l'etat de chaque voiture (position, etape, flux aleatoire) et le calendrier des etapes programmees.
+ * Aucune requete n'est en transit : la simulation est au repos, et ces trois tableaux suffisent a la reprendre a l'identique.
+ * Les statistiques des croisements et les mesures (option "-b") sont enregistrees avec eux : les compteurs, histogrammes et durees des trajets continuent a la reprise au lieu de repartir de zero.
+ * Les mesures ne sont reprises que si le point a ete ecrit avec "-b" ; la duree et le temps CPU du rapport ne couvrent que l'execution reprise.
+ *
+ * Un point de reprise est un entete suivi de ces tableaux de taille fixe. Il est projete en memoire a la reprise et recopie tel quel : le cout de la reprise est celui de la lecture du fichier.
+ * Une simulation reprise est identique a la simulation ininterrompue : memes evenements dans le meme ordre, memes voitures sorties.
+ * Les options d'admission "-e" et "-c" peuvent changer a la reprise ; la grille, MAXFILE, "-p" et "-f" (qui changent le sens de l'etat des carrefours) doivent etre les memes.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "project.h"
+#include "main.h"
+#include "voiture.h"
+#include "alea.h"
+#include "topologie.h"
+#include "charge.h"
+#include "simulation.h"
+#include "statistiques.h"
+#include "mesure.h"
+#include "reprise.h"
+
+char *chemin_point = NULL;
+long long date_point = -1;
+EnteteReprise *reprise = NULL;
+
+/**
+ * \fn unsigned long long empreinte_reprise()
+ * \brief Retourne l'empreinte de la grille de carrefours (voisins dans chaque direction) et de MAXFILE.
+ *
+ * \return L'empreinte.
+ */
+unsigned long long empreinte_reprise()
+{
+	unsigned long long e = melange(MAXFILE);
+	int i;
+
+	for (i=0;i<nb_carrefours*4;i++)
+		e = melange(e ^ (unsigned long long) (voisins[i] + 2));
+
+	return e;
+}
+
+/**
+ * \fn void sauve_voiture(VoitureReprise *v, EtatVoiture *e)
+ * \brief Copie l'etat d'une voiture dans sa forme enregistrable (voie par son indice).
+ *
+ * \param v Pointeur sur la voiture enregistrable a renseigner.
+ * \param e Pointeur sur l'etat de la voiture.
+ */
+void sauve_voiture(VoitureReprise *v, EtatVoiture *e)
+{
+	v->alea = e->alea;
+	v->arrivee = e->arrivee;
+	v->demande = e->demande;
+	v->numero = e->v.numero;
+	v->voie = e->v.voie - voies;
+	v->carrefour = e->v.carrefour;
+	v->indice = e->indice;
+	v->etape = e->etape;
+	v->ticket = e->ticket;
+}
+
+/**
+ * \fn int restaure_voiture(EtatVoiture *e, VoitureReprise *v)
+ * \brief Restaure l'etat d'une voiture depuis sa forme enregistrable.
+ *
+ * \param e Pointeur sur l'etat de la voiture a renseigner.
+ * \param v Pointeur sur la voiture enregistree.
+ *
+ * \return 1 si la voiture enregistree est valide, 0 sinon (e n'est alors pas modifie).
+ */
+int restaure_voiture(EtatVoiture *e, VoitureReprise *v)
+{
+	if (v->voie < 0 || v->voie >= 12 || v->carrefour < 1 || v->carrefour > nb_carrefours || v->indice < 0 || v->indice > voies[v->voie].nombre)
+		return 0;
+
+	e->alea = v->alea;
+	e->arrivee = v->arrivee;
+	e->demande = v->demande;
+	e->v.numero = v->numero;
+	e->v.voie = &voies[v->voie];
+	e->v.carrefour = v->carrefour;
+	e->indice = v->indice;
+	e->etape = v->etape;
+	e->ticket = v->ticket;
+	return 1;
+}
+
+/**
+ * \fn void ouvre_reprise(char *chemin)
+ * \brief Projette un point de reprise en memoire et verifie qu'il correspond a la simulation lancee.
+ *
+ * Fixe le nombre de voitures (charge_nombre) et la graine globale de la simulation a ceux du point de reprise.
+ * Quitte le programme si le fichier est invalide.
+ *
+ * \param chemin Le chemin du point de reprise.
+ */
+void ouvre_reprise(char *chemin)
+{
+	struct stat infos;
+	int fd;
+
+	fd = open(chemin, O_RDONLY);
+	if (fd == -1 || fstat(fd, &infos) == -1)
+		erreurFin("Pb ouverture reprise");
+	if (infos.st_size < sizeof(EnteteReprise)) {
+		printf("%s n'est pas un point de reprise.\n", chemin);
+		exit(-1);
+	}
+
+	reprise = mmap(NULL, infos.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (reprise == MAP_FAILED)
+		erreurFin("Pb mmap reprise");
+	close(fd);
+
+	if (memcmp(reprise->magique, MAGIQUE_REPRISE, 8) != 0 || reprise->version != VERSION_REPRISE || reprise->taille_carrefour != sizeof(Carrefour)
+			|| reprise->taille_voiture != sizeof(VoitureReprise) || reprise->taille_evenement != sizeof(EvenementReprise)
+			|| reprise->nb_voitures <= 0 || reprise->evenements < 0 || reprise->evenements > reprise->nb_voitures
+			|| sizeof(EnteteReprise) + (long long) reprise->nb_carrefours * sizeof(Carrefour) + (long long) reprise->nb_voitures * sizeof(VoitureReprise)
+				+ (long long) reprise->evenements * sizeof(EvenementReprise) + reprise->taille_statistiques + reprise->taille_mesures > infos.st_size
+			|| reprise->taille_statistiques < 0 || reprise->taille_mesures < 0) {
+		printf("%s n'est pas un point de reprise compatible (version %d attendue).\n", chemin, VERSION_REPRISE);
+		exit(-1);
+	}
+
+	if (reprise->nb_carrefours != nb_carrefours || reprise->empreinte != empreinte_reprise()) {
+		printf("%s a ete ecrit pour une autre grille de carrefours (ou une autre valeur de MAXFILE).\n", chemin);
+		exit(-1);
+	}
+	if (reprise->reservation != reservation || reprise->ordre != ordre) {
+		printf("%s a ete ecrit avec d'autres options -p / -f (enregistrees :%s%s).\n", chemin, reprise->reservation ? " -p" : "", reprise->ordre == ORDRE_TICKETS ? " -f" : "");
+		exit(-1);
+	}
+
+	charge_nombre = reprise->nb_voitures;
+	graine_globale = reprise->graine;
+}
+
+/**
+ * \fn void ecrit_reprise(EtatVoiture *voitures, int nbVoitures, Calendrier *cal, int sorties, long long nb_evenements)
+ * \brief Ecrit le point de reprise de la simulation (chemin_point) a la date virtuelle courante.
+ *
+ * L'appelant garantit qu'aucun evenement n'est en cours de traitement.
+ *
+ * \param voitures Les etats des voitures.
+ * \param nbVoitures Le nombre de voitures.
+ * \param cal Pointeur sur le calendrier.
+ * \param sorties Le nombre de voitures deja sorties.
+ * \param nb_evenements Le nombre d'evenements deja traites.
+ */
+void ecrit_reprise(EtatVoiture *voitures, int nbVoitures, Calendrier *cal, int sorties, long long nb_evenements)
+{
+	EnteteReprise entete;
+	VoitureReprise *v;
+	EvenementReprise *ev;
+	FILE *f;
+	int i;
+
+	v = malloc(nbVoitures * sizeof(VoitureReprise));
+	ev = malloc((cal->taille + 1) * sizeof(EvenementReprise));
+	if (v == NULL || ev == NULL)
+		erreurFin("Pb malloc reprise");
+
+	memset(&entete, 0, sizeof(entete));
+	memcpy(entete.magique, MAGIQUE_REPRISE, 8);
+	entete.version = VERSION_REPRISE;
+	entete.taille_carrefour = sizeof(Carrefour);
+	entete.taille_voiture = sizeof(VoitureReprise);
+	entete.taille_evenement = sizeof(EvenementReprise);
+	entete.nb_voitures = nbVoitures;
+	entete.nb_carrefours = nb_carrefours;
+	entete.evenements = cal->taille;
+	entete.sorties = sorties;
+	entete.reservation = reservation;
+	entete.ordre = ordre;
+	entete.empreinte = empreinte_reprise();
+	entete.graine = graine_globale;
+	entete.sequence = cal->sequence;
+	entete.date = date_virtuelle;
+	entete.derniere_progression = derniere_progression;
+	entete.nb_evenements = nb_evenements;
+	entete.taille_statistiques = stats != NULL ? TAILLE_STATISTIQUES(nb_carrefours) : 0;
+	entete.taille_mesures = mesures != NULL ? sizeof(Mesures) + nbVoitures * sizeof(long long) : 0;
+
+	for (i=0;i<nbVoitures;i++)
+		sauve_voiture(&v[i], &voitures[i]);
+
+	/* Le tas est ecrit tel quel : relu dans le meme ordre, il reste un tas valide. */
+	for (i=0;i<cal->taille;i++) {
+		ev[i].date = cal->tas[i].date;
+		ev[i].sequence = cal->tas[i].sequence;
+		ev[i].voiture = cal->tas[i].e - voitures;
+		ev[i].reserve = 0;
+	}
+
+	f = fopen(chemin_point, "w");
+	if (f == NULL)
+		erreurFin("Pb ouverture point de reprise");
+	if (fwrite(&entete, sizeof(entete), 1, f) != 1
+			|| fwrite(reseau, sizeof(Carrefour), nb_carrefours, f) != nb_carrefours
+			|| fwrite(v, sizeof(VoitureReprise), nbVoitures, f) != nbVoitures
+			|| fwrite(ev, sizeof(EvenementReprise), cal->taille, f) != cal->taille
+			|| (stats != NULL && fwrite(stats, entete.taille_statistiques, 1, f) != 1)
+			|| (mesures != NULL && fwrite(mesures, entete.taille_mesures, 1, f) != 1)
+			|| fclose(f) != 0)
+		erreurFin("Pb ecriture point de reprise");
+
+	free(v);
+	free(ev);
+}
+
+/**
+ * \fn void restaure_reprise(EtatVoiture *voitures, Calendrier *cal, int *sorties, long long *nb_evenements)
+ * \brief Restaure l'etat de la simulation depuis le point de reprise ouvert (voir ouvre_reprise()) : carrefours, voitures, calendrier, dates virtuelles, statistiques et mesures.
+ *
+ * Sans l'option "-c", le feu des carrefours est remis a zero. Les mesures ne sont restaurees que si elles ont ete enregistrees et sont demandees.
+ *
+ * \param voitures Les etats des voitures (reprise->nb_voitures) a renseigner.
+ * \param cal Pointeur sur le calendrier, initialise et vide.
+ * \param sorties Pointeur sur le nombre de voitures deja sorties.
+ * \param nb_evenements Pointeur sur le nombre d'evenements deja traites.
+ */
+void restaure_reprise(EtatVoiture *voitures, Calendrier *cal, int *sorties, long long *nb_evenements)
+{
+	Carrefour *carrefours_reprise = (Carrefour *) (reprise + 1);
+	VoitureReprise *v = (VoitureReprise *) (carrefours_reprise + reprise->nb_carrefours);
+	EvenementReprise *ev = (EvenementReprise *) (v + reprise->nb_voitures);
+	char *segments = (char *) (ev + reprise->evenements);
+	int i;
+
+	memcpy(reseau, carrefours_reprise, nb_carrefours * sizeof(Carrefour));
+	if (feux == 0)
+		for (i=0;i<nb_carrefours;i++)
+			reseau[i].feu = 0;
+
+	for (i=0;i<reprise->nb_voitures;i++) {
+		if (restaure_voiture(&voitures[i], &v[i]) == 0) {
+			printf("Voiture %d invalide dans le point de reprise.\n", i);
+			exit(-1);
+		}
+	}
+
+	for (i=0;i<reprise->evenements;i++) {
+		if (ev[i].voiture < 0 || ev[i].voiture >= reprise->nb_voitures) {
+			printf("Evenement %d invalide dans le point de reprise.\n", i);
+			exit(-1);
+		}
+		cal->tas[i].date = ev[i].date;
+		cal->tas[i].sequence = ev[i].sequence;
+		cal->tas[i].e = &voitures[ev[i].voiture];
+	}
+	cal->taille = reprise->evenements;
+	cal->sequence = reprise->sequence;
+
+	date_virtuelle = reprise->date;
+	derniere_progression = reprise->derniere_progression;
+	*sorties = reprise->sorties;
+	*nb_evenements = reprise->nb_evenements;
+
+	if (stats != NULL && reprise->taille_statistiques == TAILLE_STATISTIQUES(nb_carrefours))
+		memcpy(stats, segments, reprise->taille_statistiques);
+	if (mesures != NULL && reprise->taille_mesures == sizeof(Mesures) + reprise->nb_voitures * sizeof(long long))
+		memcpy(mesures, segments + reprise->taille_statistiques, reprise->taille_mesures);
+}
@@ -0,0 +1,81 @@
+#ifndef __REPRISE__
+#define __REPRISE__
+
+#include "project.h"
+#include "calendrier.h"
+
+/*! La signature placee en tete des points de reprise. */
+#define MAGIQUE_REPRISE "CARREPRI"
+/*! La version du format des points de reprise. */
+#define VERSION_REPRISE 3
+
+/**
+ * \struct EnteteReprise
+ * \brief Represente l'entete d'un point de reprise (112 octets).
+ *
+ * L'entete est suivi des carrefours (nb_carrefours Carrefour), des voitures (nb_voitures VoitureReprise), du calendrier (evenements EvenementReprise), puis des segments des statistiques et des mesures tels quels.
+ */
+typedef struct EnteteReprise {
+	char magique[8];	/*!< La signature MAGIQUE_REPRISE. */
+	int version;	/*!< La version du format (VERSION_REPRISE). */
+	int taille_carrefour;	/*!< La taille d'un carrefour (sizeof(Carrefour)). */
+	int taille_voiture;	/*!< La taille d'une voiture (sizeof(VoitureReprise)). */
+	int taille_evenement;	/*!< La taille d'un evenement (sizeof(EvenementReprise)). */
+	int nb_voitures;	/*!< Le nombre de voitures de la simulation. */
+	int nb_carrefours;	/*!< Le nombre de carrefours de la grille. */
+	int evenements;	/*!< Le nombre d'evenements programmes dans le calendrier. */
+	int sorties;	/*!< Le nombre de voitures deja sorties. */
+	int reservation;	/*!< L'option "-p" de la simulation enregistree. */
+	int ordre;	/*!< L'ordre d'admission (option "-f") de la simulation enregistree. */
+	unsigned long long empreinte;	/*!< L'empreinte de la grille (voisins des carrefours) et de MAXFILE, voir empreinte_reprise(). */
+	unsigned long long graine;	/*!< La graine globale de la simulation enregistree. */
+	unsigned long long sequence;	/*!< Le prochain numero d'ordre du calendrier. */
+	long long date;	/*!< La date virtuelle du point de reprise (en microseconde). */
+	long long derniere_progression;	/*!< La date virtuelle de la derniere autorisation accordee. */
+	long long nb_evenements;	/*!< Le nombre d'evenements deja traites. */
+	long long taille_statistiques;	/*!< La taille des statistiques enregistrees (TAILLE_STATISTIQUES()). */
+	long long taille_mesures;	/*!< La taille des mesures enregistrees, 0 si la simulation n'etait pas mesuree (option "-b"). */
+} EnteteReprise;
+
+/**
+ * \struct VoitureReprise
+ * \brief Represente l'etat d'une voiture dans un point de reprise (56 octets) : un EtatVoiture dont la voie est un numero et non un pointeur.
+ */
+typedef struct VoitureReprise {
+	Alea alea;	/*!< Le flux aleatoire de la voiture (cle et compteur). */
+	long long arrivee;	/*!< La date d'arrivee de la voiture sur la carte. */
+	long long demande;	/*!< La date de la premiere emission de la demande en cours, -1 si aucune. */
+	int numero;	/*!< Le numero de la voiture. */
+	int voie;	/*!< L'indice de la voie de la voiture dans voies (0 a 11). */
+	int carrefour;	/*!< Le carrefour ou se trouve la voiture. */
+	int indice;	/*!< L'indice du croisement courant dans la voie. */
+	int etape;	/*!< L'etape courante. */
+	int ticket;	/*!< Le ticket de la demande en cours, -1 si aucun. */
+} VoitureReprise;
+
+/**
+ * \struct EvenementReprise
+ * \brief Represente un evenement du calendrier dans un point de reprise (24 octets).
+ */
+typedef struct EvenementReprise {
+	long long date;	/*!< La date de l'etape (en microseconde). */
+	unsigned long long sequence;	/*!< Le numero d'ordre de programmation. */
+	int voiture;	/*!< L'indice de la voiture concernee. */
+	int reserve;	/*!< Reserve, complete l'evenement a 24 octets. */
+} EvenementReprise;
+
+extern char *chemin_point;	/*!< Le fichier du point de reprise a ecrire (option "-k"), NULL si aucun. */
+extern long long date_point;	/*!< La date virtuelle du point de reprise a ecrire (en microseconde). */
+extern EnteteReprise *reprise;	/*!< Le point de reprise projete en memoire (option "-K"), NULL si aucun. */
+
+void sauve_voiture(VoitureReprise *v, EtatVoiture *e);
+
+int restaure_voiture(EtatVoiture *e, VoitureReprise *v);
+
+void ouvre_reprise(char *chemin);
+
+void ecrit_reprise(EtatVoiture *voitures, int nbVoitures, Calendrier *cal, int sorties, long long nb_evenements);
+
+void restaure_reprise(EtatVoiture *voitures, Calendrier *cal, int *sorties, long long *nb_evenements);
+
+#endif
@@ -1,25 +1,110 @@
 /**
  * \file sem.c
  * \brief Gere les semaphores et les operations sur ces dernieres
+ *
+ * Chaque semaphore est un verrou binaire en memoire partagee (Verrou) : les prises et les rendus sans concurrence se font par une operation atomique, sans appel systeme.
+ * Un processus ne s'endort dans le noyau (futex) qu'apres une courte attente active, si le verrou est toujours pris.
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 #include "project.h"
+#include "main.h"
 #include "sem.h"
 
+Verrou *verrous;
+
+/**
+ * \fn void attente_verrou(int *adresse, int valeur)
+ * \brief Endort l'appelant tant que le mot vaut la valeur donnee (appel systeme futex).
+ *
+ * Le futex n'est pas prive : le mot est dans un segment partage par tous les processus.
+ *
+ * \param adresse L'adresse du mot.
+ * \param valeur La valeur attendue.
+ */
+void attente_verrou(int *adresse, int valeur)
+{
+	syscall(SYS_futex, adresse, FUTEX_WAIT, valeur, NULL, NULL, 0);
+}
+
+/**
+ * \fn void reveil_verrou(int *adresse)
+ * \brief Reveille un processus endormi sur le mot (appel systeme futex).
+ *
+ * \param adresse L'adresse du mot.
+ */
+void reveil_verrou(int *adresse)
+{
+	syscall(SYS_futex, adresse, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+/**
+ * \fn void verrouille(Verrou *v)
+ * \brief Prend un verrou.
+ *
+ * Sans concurrence, une seule operation atomique suffit (0 -> 1), sans appel systeme.
+ * Sinon, l'appelant tourne un temps (au plus v->tours essais, un peu plus a chaque fois), puis marque le verrou comme attendu (2) et s'endort sur le futex.
+ * La duree de l'attente active s'adapte au verrou : elle tend vers le nombre d'essais qu'il a fallu les fois precedentes.
+ *
+ * \param v Pointeur sur le verrou.
+ */
+void verrouille(Verrou *v)
+{
+	int libre = 0, moyenne, tours, i;
+
+	if (__atomic_compare_exchange_n(&v->etat, &libre, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+		return;
+
+	moyenne = __atomic_load_n(&v->tours, __ATOMIC_RELAXED);
+	tours = moyenne * 2 + 10;
+	if (tours > TOURS_VERROU)
+		tours = TOURS_VERROU;
+	for (i=0;i<tours;i++) {
+		libre = 0;
+		if (__atomic_load_n(&v->etat, __ATOMIC_RELAXED) == 0
+				&& __atomic_compare_exchange_n(&v->etat, &libre, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			break;
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#endif
+	}
+	__atomic_store_n(&v->tours, moyenne + (i - moyenne) / 8, __ATOMIC_RELAXED);
+	if (i < tours)
+		return;
+
+	while (__atomic_exchange_n(&v->etat, 2, __ATOMIC_ACQUIRE) != 0)
+		attente_verrou(&v->etat, 2);
+}
+
+/**
+ * \fn void deverrouille(Verrou *v)
+ * \brief Rend un verrou, et reveille un processus endormi s'il etait attendu.
+ *
+ * \param v Pointeur sur le verrou.
+ */
+void deverrouille(Verrou *v)
+{
+	if (__atomic_exchange_n(&v->etat, 0, __ATOMIC_RELEASE) == 2)
+		reveil_verrou(&v->etat);
+}
+
 /**
  * \fn void P(int semnum)
  * \brief Decremente le semaphore (blocage)
  *
+ * Le semaphore est un verrou en memoire partagee (voir verrouille()) : sans concurrence, aucun appel systeme.
+ *
  * \param semnum Le numero du semaphore.
  */
 void P(int semnum)
 {
-	sem_oper.sem_num = semnum-1;	// Numéro du sémaphore
-	sem_oper.sem_op = -1 ;	// Opération (P(s))
-	sem_oper.sem_flg = 0 ;	// NULL
-
-	semop(sem,&sem_oper,1);
+	verrouille(&verrous[semnum-1]);
 }
 
 /**
@@ -30,22 +115,104 @@ void P(int semnum)
  */
 void V(int semnum)
 {
-	sem_oper.sem_num = semnum-1;	// Numéro du sémaphore
-	sem_oper.sem_op = 1 ;	// Opération (V(s))
-	sem_oper.sem_flg = 0 ;	// NULL
+	deverrouille(&verrous[semnum-1]);
+}
+
+/**
+ * \fn int sem_croisement(int carrefour, int croisement)
+ * \brief Retourne le numero du semaphore protegeant un croisement d'un carrefour.
+ *
+ * \param carrefour Le numero du carrefour (1<=carrefour<=nb_carrefours).
+ * \param croisement L'indice du croisement (0<=croisement<25).
+ *
+ * \return Le numero du semaphore (utilisable avec P() et V()).
+ */
+int sem_croisement(int carrefour, int croisement)
+{
+	return SEM_CROISEMENTS + (carrefour-1)*25 + croisement;
+}
+
+/**
+ * \fn void operation_croisements(int carrefour, int i, int j, int op)
+ * \brief Effectue la meme operation sur les semaphores de 2 croisements d'un carrefour.
+ *
+ * Les semaphores sont pris par numero croissant (ordre de verrouillage du projet) et rendus dans l'ordre inverse : une voiture qui verrouille son croisement et son croisement precedent ne peut donc pas interbloquer avec une autre.
+ *
+ * \param carrefour Le numero du carrefour.
+ * \param i L'indice du premier croisement (-1 si aucun).
+ * \param j L'indice du second croisement (-1 si aucun ou identique au premier).
+ * \param op L'operation (-1 pour P, 1 pour V).
+ */
+void operation_croisements(int carrefour, int i, int j, int op)
+{
+	int tmp;
+
+	if (i == -1 || i == j) {
+		i = j;
+		j = -1;
+	}
+	if (i == -1)
+		return;
+	if (j != -1 && j < i) {
+		tmp = i;
+		i = j;
+		j = tmp;
+	}
+
+	if (op == -1) {
+		P(sem_croisement(carrefour, i));
+		if (j != -1)
+			P(sem_croisement(carrefour, j));
+	} else {
+		if (j != -1)
+			V(sem_croisement(carrefour, j));
+		V(sem_croisement(carrefour, i));
+	}
+}
 
-	semop(sem,&sem_oper,1);
+/**
+ * \fn void P_croisements(int carrefour, int i, int j)
+ * \brief Verrouille 1 ou 2 croisements d'un carrefour (voir operation_croisements()).
+ *
+ * \param carrefour Le numero du carrefour.
+ * \param i L'indice du croisement (-1 si aucun).
+ * \param j L'indice du croisement precedent (-1 si aucun).
+ */
+void P_croisements(int carrefour, int i, int j)
+{
+	operation_croisements(carrefour, i, j, -1);
+}
+
+/**
+ * \fn void V_croisements(int carrefour, int i, int j)
+ * \brief Deverrouille 1 ou 2 croisements d'un carrefour (voir operation_croisements()).
+ *
+ * \param carrefour Le numero du carrefour.
+ * \param i L'indice du croisement (-1 si aucun).
+ * \param j L'indice du croisement precedent (-1 si aucun).
+ */
+void V_croisements(int carrefour, int i, int j)
+{
+	operation_croisements(carrefour, i, j, 1);
 }
 
 /**
  * \fn int initialise_semaphore()
- * \brief Initialise les semaphores. Un seul semaphore est utilise ici.
+ * \brief Initialise les semaphores : MUTEX (compteur de voitures sorties) puis 1 semaphore par croisement de chaque carrefour.
+ *
+ * Les semaphores sont des verrous places dans un segment de memoire partagee, attache une seule fois avant les fork (une ligne de cache par verrou).
+ * Les autres moteurs n'utilisent pas les semaphores de croisement (verrous des threads, ou un seul thread).
  */
 int initialise_semaphore()
 {
-	sem = semget(IPC_PRIVATE, 1, IPC_CREAT | IPC_EXCL | 0666);
+	sem = shmget(IPC_PRIVATE, nb_semaphores * sizeof(Verrou), IPC_CREAT | IPC_EXCL | 0666);
+	if (sem == -1)
+		erreurFin("Pb shmget semaphores");
+	verrous = shmat(sem, NULL, 0);
+	if (verrous == (void *) -1)
+		erreurFin("Pb shmat semaphores");
 
-	semctl(sem, 0, SETVAL, 1);
+	memset(verrous, 0, nb_semaphores * sizeof(Verrou));
 
 	return (sem);
 }
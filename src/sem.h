@@ -1,14 +1,44 @@
 #ifndef __SEM__
 #define __SEM__
 
-#include <sys/sem.h>
+#include "project.h"
 
-struct sembuf sem_oper;
+/*! Le nombre maximal d'essais de l'attente active avant de s'endormir sur un verrou pris. */
+#define TOURS_VERROU 200
+
+/**
+ * \struct Verrou
+ * \brief Represente un semaphore binaire en memoire partagee, pris sans appel systeme en l'absence de concurrence (voir verrouille()).
+ *
+ * Chaque verrou occupe sa propre ligne de cache (voir TAILLE_LIGNE_CACHE).
+ */
+typedef struct Verrou {
+	int etat;	/*!< 0 : libre, 1 : pris, 2 : pris et attendu par au moins un processus endormi (futex). */
+	int tours;	/*!< La duree moyenne des attentes actives reussies sur ce verrou (en nombre d'essais). */
+} __attribute__((aligned(TAILLE_LIGNE_CACHE))) Verrou;
+
+extern Verrou *verrous;	/*!< Les semaphores, attaches une seule fois avant les fork (verrous[semnum-1]). */
+
+void attente_verrou(int *adresse, int valeur);
+
+void reveil_verrou(int *adresse);
+
+void verrouille(Verrou *v);
+
+void deverrouille(Verrou *v);
 
 void P(int semnum);
 
 void V(int semnum);
 
+int sem_croisement(int carrefour, int croisement);
+
+void operation_croisements(int carrefour, int i, int j, int op);
+
+void P_croisements(int carrefour, int i, int j);
+
+void V_croisements(int carrefour, int i, int j);
+
 int initialise_semaphore();
 
 #endif
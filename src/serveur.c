@@ -3,6 +3,7 @@
  * \brief Contient le code du serveur dans le modele client-serveur (le serveur).
  *
  * Ici, le serveur est un serveur pour les carrefours, selon le modele client-serveur. Il recoit des requetes des carrefours et leur renvoie des reponses.
+ * Les decisions sont renvoyees dans la file de chaque carrefour (MESSDECISION), avec ses autres evenements : un carrefour peut ainsi avoir plusieurs demandes en cours aupres du serveur.
  */
 #include <stdio.h>
 #include <stdlib.h>
@@ -10,25 +11,97 @@
 #include <sys/shm.h>
 #include <sys/types.h>
 #include "project.h"
+#include "sem.h"
 #include "serveur.h"
+#include "client.h"
 #include "interface.h"
+#include "mesure.h"
+#include "message.h"
+#include "transport.h"
+#include "statistiques.h"
+#include "interblocage.h"
+#include "carrefour.h"
+#include "feux.h"
+
+/*! Les decisions qui n'ont pas pu etre deposees, dans l'ordre (tete de file). */
+Decision *decisions_tete = NULL;
+/*! Les decisions qui n'ont pas pu etre deposees (queue de file). */
+Decision *decisions_queue = NULL;
 
 /**
  * \fn void serveur()
  * \brief Fonction realisee par le serveur.
  *
- * Receptionne sans arret les requetes des carrefours dans sa file de message (1 pour tous les carrefours), les traite et retourne les reponses dans sa file.
+ * Receptionne sans arret les requetes des carrefours dans sa file de message (1 pour tous les carrefours), les traite et retourne les decisions dans la file de chaque carrefour.
+ * Le serveur ne bloque jamais sur un envoi (voir envoie_decision()) : un carrefour qui attend de la place dans la file du serveur ne peut donc pas l'interbloquer.
+ * En ADMISSION_LOCALE, les carrefours decident eux memes et ne lui soumettent plus de demande.
  */
 void serveur()
 {
 	Requete req;
 	Reponse rep;
+	Message m;
 
 	while (1) {
-		msgrcv(msg_serveur,&req,tailleReq,getpid(),0);
+		envoie_decisions();
+
+		if (transport->recoit_requete(FILE_SERVEUR, &m, decisions_tete == NULL ? ATTENTE_INFINIE : MINPAUSE) == -1 || decode_requete(&m, &req) == -1)
+			continue;
 		constructionReponse(&req, &rep);
-		msgsnd(msg_serveur,&rep,tailleRep,0);
+		encode_decision(&req, rep.autorisation, &m);
+		envoie_decision(&m, req.carrefour);
+	}
+}
+
+/**
+ * \fn void envoie_decision(Message *m, int carrefour)
+ * \brief Depose une decision dans la file d'un carrefour sans jamais bloquer : si la file est pleine, la decision est differee (voir envoie_decisions()).
+ *
+ * \param m Pointeur sur la decision encodee.
+ * \param carrefour Le carrefour destinataire.
+ */
+void envoie_decision(Message *m, int carrefour)
+{
+	Decision *d;
+
+	if (decisions_tete == NULL && transport->envoie_requete(carrefour, m, 0) == 0) {
+		compte_message();
+		return;
 	}
+
+	d = malloc(sizeof(Decision));
+	if (d == NULL) {
+		perror("Pb malloc decision");
+		exit(1);
+	}
+	d->m = *m;
+	d->carrefour = carrefour;
+	d->suivant = NULL;
+
+	if (decisions_queue == NULL)
+		decisions_tete = d;
+	else
+		decisions_queue->suivant = d;
+	decisions_queue = d;
+}
+
+/**
+ * \fn void envoie_decisions()
+ * \brief Redepose, dans l'ordre, les decisions differees tant que les files des carrefours ont de la place.
+ */
+void envoie_decisions()
+{
+	Decision *d;
+
+	while (decisions_tete != NULL && transport->envoie_requete(decisions_tete->carrefour, &decisions_tete->m, 0) == 0) {
+		compte_message();
+		d = decisions_tete;
+		decisions_tete = d->suivant;
+		free(d);
+	}
+
+	if (decisions_tete == NULL)
+		decisions_queue = NULL;
 }
 
 /**
@@ -39,54 +112,93 @@ void serveur()
  * - Autorisation : autorise la voiture a avancer / traverser dans la zone / le croisement demande.
  * - Interdiction : interdit la voiture de avancer / traverser dans la zone / le croisement demande.
  *
+ * Seul le croisement demande est verrouille le temps de la decision.
+ *
  * \param req Pointeur sur la requete qui a ete recue.
  * \param rep Pointeur sur la reponse qui va etre renseignee.
  */
 void constructionReponse(Requete *req,Reponse *rep)
 {
-	P(MUTEX);
+	P_croisements(req->carrefour, req->croisement, -1);
 	rep->type = req->pidEmetteur;
 
+	rep->autorisation = decision(&reseau[req->carrefour-1], req);
+
+	V_croisements(req->carrefour, req->croisement, -1);
+}
+
+/**
+ * \fn int decision(Carrefour *c, Requete *req)
+ * \brief Decide si la voiture peut avancer / traverser dans la zone / le croisement demande.
+ *
+ * Une demande qui porte un ticket (ordre par tickets, option "-f") n'est accordee que lorsque sa case sert ce ticket (voir a_son_tour()).
+ * Avec les feux (option "-c"), une traversee depuis une ligne d'arret n'est accordee que si la phase de sa voie est verte (voir feu_vert()).
+ * Avec l'evitement des interblocages (option "-e"), une demande possible n'est accordee que si le carrefour reste dans un etat sur (voir etat_sur()) ; l'appelant doit alors garantir l'acces exclusif a tout le carrefour.
+ * N'effectue aucune synchronisation : l'appelant doit garantir l'acces exclusif au carrefour.
+ *
+ * \param c Pointeur sur le carrefour concerne par la requete.
+ * \param req Pointeur sur la requete qui a ete recue.
+ *
+ * \return 1 si la voiture est autorisee a avancer, 0 sinon.
+ */
+int decision(Carrefour *c, Requete *req)
+{
+	if (a_son_tour(c, req) == 0 || place_libre(c, req) == 0)
+		return 0;
+
+	if (feux == 1 && feu_vert(c, req) == 0)
+		return 0;
+
+	if (evitement == 1 && etat_sur(c, req) == 0) {
+		stats_evitement();
+		return 0;
+	}
+
+	return 1;
+}
+
+/**
+ * \fn int place_libre(Carrefour *c, Requete *req)
+ * \brief Indique si la zone / le croisement demande a une place libre.
+ *
+ * \param c Pointeur sur le carrefour concerne par la requete.
+ * \param req Pointeur sur la requete qui a ete recue.
+ *
+ * \return 1 si la zone / le croisement a une place libre, 0 sinon.
+ */
+int place_libre(Carrefour *c, Requete *req)
+{
 	int i = req->croisement;
 	int traverse = req->traverse;
 	int orientation = req->croisement_orientation;
-	int numero = req->carrefour;
 
-	rep->autorisation = 0;
-
-	Carrefour *c;
-	
-	c = shmat(carrefours[numero-1], NULL, 0);
-	
 	if (traverse == AVANT) {
 		if (orientation == HO) {
 			if (c->croisements[i].avantH < MAXFILE) {
-				rep->autorisation = 1;
+				return 1;
 			}
 		} else {
 			if (c->croisements[i].avantV < MAXFILE) {
-				rep->autorisation = 1;
+				return 1;
 			}
 		}
 	} else if (traverse == PENDANT) {
 		if (c->croisements[i].etat == 0) {
-			rep->autorisation = 1;
+			return 1;
 		}
 	} else if (traverse == APRES) {
 		if (orientation == HO) {
 			if (c->croisements[i].apresH < MAXFILE) {
-				rep->autorisation = 1;
+				return 1;
 			}
 		} else {
 			if (c->croisements[i].apresV < MAXFILE) {
-				rep->autorisation = 1;
+				return 1;
 			}
 		}
 	}
 
-	shmdt(c);
-
-	V(MUTEX);
+	return 0;
 }
 
 /**
@@ -98,18 +210,5 @@ void constructionReponse(Requete *req,Reponse *rep)
  */
 void affichageReponse(Requete *req,Reponse *rep)
 {
-	int traverse = req->traverse;
-
-	if (traverse == AVANT) {
-		if (rep->autorisation == 1) sprintf(buffer, "   Aut. av. voie %d\n", req->voie);
-		else if (rep->autorisation == 0) sprintf(buffer, "   Int. av. voie %d\n", req->voie);
-	} else if (traverse == PENDANT) {
-		if (rep->autorisation == 1) sprintf(buffer, "   Aut. trav. voie %d\n", req->voie);
-		else if (rep->autorisation == 0) sprintf(buffer, "   Int. trav. voie %d\n", req->voie);
-	} else if (traverse == APRES) {
-		if (rep->autorisation == 1) sprintf(buffer, "   Aut. ap. voie %d\n", req->voie);
-		else if (rep->autorisation == 0) sprintf(buffer, "   Int. ap. voie %d\n", req->voie);
-	}
-
-	message(req->v.numero, buffer);
+	affichageAutorisation(req, rep->autorisation);
 }
@@ -1,10 +1,30 @@
 #ifndef __SERVEUR__
 #define __SERVEUR__
 
+#include "project.h"
+
+/**
+ * \struct Decision
+ * \brief Represente une decision qui n'a pas pu etre deposee dans la file pleine d'un carrefour (element d'une file chainee).
+ */
+typedef struct Decision {
+	Message m;	/*!< La decision encodee. */
+	int carrefour;	/*!< Le carrefour destinataire. */
+	struct Decision *suivant;	/*!< La decision suivante dans la file. */
+} Decision;
+
 void serveur();
 
+void envoie_decision(Message *m, int carrefour);
+
+void envoie_decisions();
+
 void constructionReponse(Requete *req,Reponse *rep);
 
+int decision(Carrefour *c, Requete *req);
+
+int place_libre(Carrefour *c, Requete *req);
+
 void affichageReponse(Requete *req,Reponse *rep);
 
 #endif
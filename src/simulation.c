@@ -0,0 +1,169 @@
+/**
+ * \file simulation.c
+ * \brief Contient le moteur de simulation a evenements discrets (temps virtuel, un seul processus).
+ *
+ * Les voitures suivent le meme parcours que dans les autres moteurs (etape_voiture()), mais les pauses ne sont jamais attendues :
+ * chaque etape est programmee dans un calendrier a la date virtuelle voulue, et le moteur saute directement d'un evenement au suivant.
+ * Les flux aleatoires des voitures ne dependent que de la graine globale (1 par defaut) et le calendrier departage les evenements simultanes par ordre de programmation : deux executions donnent des resultats identiques.
+ * En charge ouverte (options "-o" et "-O"), les arrivees sont generees au fil de la simulation et injectees dans l'ordre des dates, avant les evenements du calendrier de meme date.
+ * Entre deux evenements, tout l'etat de la simulation est dans ce processus : il peut etre ecrit dans un point de reprise (option "-k") et repris plus tard (option "-K", voir reprise.c).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/types.h>
+#include "project.h"
+#include "main.h"
+#include "interface.h"
+#include "voiture.h"
+#include "carrefour.h"
+#include "serveur.h"
+#include "calendrier.h"
+#include "moteur.h"
+#include "trace.h"
+#include "simulation.h"
+#include "charge.h"
+#include "mesure.h"
+#include "reprise.h"
+
+/*! La date virtuelle courante (en microseconde). */
+long long date_virtuelle;
+/*! La date virtuelle de la derniere autorisation accordee. */
+long long derniere_progression;
+
+/**
+ * \fn void simulation_evenements(int nbVoitures)
+ * \brief Lance la simulation a evenements discrets et la deroule jusqu'a la sortie de toutes les voitures (ou jusqu'a un interblocage).
+ *
+ * Chaque voiture est programmee a sa date d'arrivee, avec la voie et le carrefour correspondants (voir arrivee_voiture()), sauf a la reprise d'un point de reprise, qui fournit les voitures et le calendrier.
+ * En charge ouverte, les voitures entrent au fil des arrivees generees (voir prochaine_arrivee()) sous un numero libre, rendu a leur sortie.
+ * Si un point de reprise est demande, il est ecrit avant le premier evenement posterieur a sa date, et la simulation s'arrete.
+ *
+ * \param nbVoitures Le nombre de voitures a creer (en charge ouverte : le nombre maximal de voitures en route).
+ */
+void simulation_evenements(int nbVoitures)
+{
+	EtatVoiture *voitures;
+	Calendrier cal;
+	Evenement ev;
+	Arrivee a;
+	long long debut, nb_evenements = 0;
+	int i, pause, sorties = 0, point = 0, suivante = 0, bloquees, *c;
+
+	debut = maintenant();
+
+	voitures = malloc(nbVoitures * sizeof(EtatVoiture));
+	if (voitures == NULL)
+		erreurFin("Pb malloc simulation");
+
+	initialise_calendrier(&cal, nbVoitures);
+	date_virtuelle = 0;
+	derniere_progression = 0;
+
+	if (reprise != NULL) {
+		restaure_reprise(voitures, &cal, &sorties, &nb_evenements);
+		sprintf(buffer, "Reprise a %.3f s de temps virtuel (%d voitures sorties), restauree en %.3f ms\n", date_virtuelle/1000000.0, sorties, (maintenant()-debut)/1000.0);
+		bilan(buffer);
+	} else if (charge_ouverte) {
+		suivante = prochaine_arrivee(&a);
+		if (!suivante)
+			fin_generation();
+	} else {
+		for (i=0;i<nbVoitures;i++) {
+			arrivee_voiture(i, &a);
+			initialise_etat(&voitures[i], i, a.voie, a.carrefour);
+			voitures[i].arrivee = a.date;
+			programme(&cal, a.date, &voitures[i]);
+		}
+	}
+
+	while (1) {
+		affiche_statistiques_demandees();
+		if (chemin_point != NULL && cal.taille > 0 && cal.tas[0].date > date_point) {
+			ecrit_reprise(voitures, nbVoitures, &cal, sorties, nb_evenements);
+			point = 1;
+			break;
+		}
+		if (suivante && (cal.taille == 0 || a.date <= cal.tas[0].date)) {
+			date_virtuelle = a.date;
+			i = entree_voiture(voitures, &a);
+			if (i != -1) {
+				voitures[i].arrivee = a.date;
+				programme(&cal, a.date, &voitures[i]);
+			}
+			suivante = prochaine_arrivee(&a);
+			if (!suivante)
+				fin_generation();
+			continue;
+		}
+		if (!prochain(&cal, &ev))
+			break;
+
+		date_virtuelle = ev.date;
+		if (progression_voiture(ev.e))
+			derniere_progression = date_virtuelle;
+		if (date_virtuelle - derniere_progression > DUREE_INTERBLOCAGE)
+			break;
+
+		trace_date_virtuelle(date_virtuelle);
+		pause = etape_voiture(ev.e, demande_simulation, date_virtuelle);
+		nb_evenements++;
+
+		if (pause == FIN) {
+			sorties++;
+			mesure_trajet(date_virtuelle - ev.e->arrivee);
+			if (charge_ouverte)
+				sortie_voiture(ev.e->v.numero, date_virtuelle);
+		}
+		else
+			programme(&cal, date_virtuelle + pause, ev.e);
+	}
+
+	c = shmat(compteur, NULL, 0);
+	*c = sorties;
+	sprintf(buffer, "%d Voitures sont sorties\n", sorties);
+	bilan(buffer);
+	if (point == 1) {
+		sprintf(buffer, "Point de reprise %s ecrit a %.3f s de temps virtuel (%d voitures en route)\n", chemin_point, date_virtuelle/1000000.0, cal.taille);
+		bilan(buffer);
+	} else if ((bloquees = charge_ouverte ? charge_en_route : nbVoitures - sorties) > 0) {
+		sprintf(buffer, "Interblocage : %d voitures bloquees depuis %.3f s (temps virtuel)\n", bloquees, (date_virtuelle - derniere_progression)/1000000.0);
+		bilan(buffer);
+	}
+	sprintf(buffer, "%lld evenements, %.3f s de temps virtuel simules en %.3f s\n", nb_evenements, derniere_progression/1000000.0, (maintenant()-debut)/1000000.0);
+	bilan(buffer);
+	shmdt(c);
+
+	detruit_calendrier(&cal);
+	free(voitures);
+}
+
+/**
+ * \fn int demande_simulation(Requete *req)
+ * \brief Traite une requete d'une voiture : decision et mise a jour du carrefour (aucune synchronisation, un seul thread).
+ *
+ * En reservation de parcours, la requete porte sur l'occupation du carrefour (voir reserve_croisement()).
+ *
+ * \param req Pointeur sur la requete de la voiture.
+ *
+ * \return L'autorisation (toujours 1 pour un MESSSORT).
+ */
+int demande_simulation(Requete *req)
+{
+	Carrefour *c = &reseau[req->carrefour-1];
+	int autorisation = 1;
+
+	if (reservation == 1) {
+		autorisation = reserve_croisement(req, c);
+	} else {
+		if (req->type == MESSDEMANDE)
+			autorisation = decision(c, req);
+		if (autorisation == 1)
+			maj_croisements(req, c);
+	}
+	if (autorisation == 1)
+		derniere_progression = date_virtuelle;
+
+	return autorisation;
+}
@@ -0,0 +1,17 @@
+#ifndef __SIMULATION__
+#define __SIMULATION__
+
+#include "project.h"
+
+/*! La duree (virtuelle, en microseconde) sans aucune autorisation au dela de laquelle la simulation est consideree interbloquee et arretee.
+ * Passee cette duree, toutes les voitures ont termine leur pause et vu leur demande refusee : plus rien ne peut changer. */
+#define DUREE_INTERBLOCAGE (2LL * (MAXPAUSE + MINPAUSE))
+
+extern long long date_virtuelle;	/*!< La date virtuelle courante du moteur a evenements discrets (en microseconde). */
+extern long long derniere_progression;	/*!< La date virtuelle de la derniere autorisation accordee. */
+
+void simulation_evenements(int nbVoitures);
+
+int demande_simulation(Requete *req);
+
+#endif
@@ -0,0 +1,251 @@
+/**
+ * \file statistiques.c
+ * \brief Contient les statistiques d'attente de chaque croisement : histogrammes des attentes et compteurs d'accords / refus.
+ *
+ * Les statistiques sont placees dans un segment de memoire partagee cree avant les fork et mises a jour sans verrou (additions atomiques) par tous les moteurs.
+ * Elles sont affichees sur SIGUSR1 (processus principal) ou relues pendant la simulation par le programme releve.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/types.h>
+#include "project.h"
+#include "statistiques.h"
+
+int statistiques = -1;
+Statistiques *stats = NULL;
+
+/*! Les noms des etapes, pour l'affichage. */
+char *noms_etapes[] = {"AVANT", "PENDANT", "APRES"};
+/*! Les noms des orientations, pour l'affichage. */
+char *noms_orientations[] = {"HO", "VE"};
+
+/**
+ * \fn void initialise_statistiques(int nb)
+ * \brief Cree et attache le segment de memoire partagee des statistiques (initialise a 0).
+ *
+ * Si le segment ne peut pas etre cree (grille trop grande pour la memoire ou la limite SHMMAX), la simulation se deroule sans statistiques.
+ *
+ * \param nb Le nombre de carrefours de la grille.
+ */
+void initialise_statistiques(int nb)
+{
+	statistiques = shmget(IPC_PRIVATE, TAILLE_STATISTIQUES(nb), IPC_CREAT | 0644);
+	if (statistiques == -1) {
+		perror("Pb shmget statistiques, simulation sans statistiques");
+		return;
+	}
+	stats = shmat(statistiques, NULL, 0);
+	if (stats == (void *) -1) {
+		perror("Pb shmat statistiques");
+		exit(1);
+	}
+	stats->nb_carrefours = nb;
+}
+
+/**
+ * \fn int classe(long long attente)
+ * \brief Retourne la classe d'histogramme d'une attente (voir NB_CLASSES).
+ */
+int classe(long long attente)
+{
+	int k;
+
+	if (attente <= 0)
+		return 0;
+	k = 64 - __builtin_clzll(attente);
+	return k < NB_CLASSES ? k : NB_CLASSES-1;
+}
+
+/**
+ * \fn StatsCroisement *stats_croisement(Requete *req)
+ * \brief Retourne les statistiques du croisement vise par une demande, NULL si elles n'existent pas ou si la demande ne vise pas un croisement.
+ */
+StatsCroisement *stats_croisement(Requete *req)
+{
+	if (stats == NULL || req->croisement < 0 || req->traverse < AVANT || req->traverse > APRES)
+		return NULL;
+	return &stats->croisements[req->carrefour-1][req->croisement];
+}
+
+/**
+ * \fn void stats_accord(Requete *req, long long attente)
+ * \brief Enregistre l'autorisation d'une demande.
+ *
+ * \param req Pointeur sur la demande autorisee.
+ * \param attente La duree entre l'emission de la demande et son autorisation (en microseconde).
+ */
+void stats_accord(Requete *req, long long attente)
+{
+	StatsCroisement *s = stats_croisement(req);
+	int t, o;
+
+	if (s == NULL)
+		return;
+
+	t = req->traverse - AVANT;
+	o = req->croisement_orientation;
+	__atomic_add_fetch(&s->accords[t][o], 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&s->attente[t][o], attente, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&s->histogramme[t][o][classe(attente)], 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * \fn void stats_refus(Requete *req)
+ * \brief Enregistre le premier refus d'une demande.
+ *
+ * \param req Pointeur sur la demande refusee.
+ */
+void stats_refus(Requete *req)
+{
+	StatsCroisement *s = stats_croisement(req);
+
+	if (s == NULL)
+		return;
+
+	__atomic_add_fetch(&s->refus[req->traverse - AVANT][req->croisement_orientation], 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * \fn void stats_interblocage()
+ * \brief Compte un interblocage detecte.
+ */
+void stats_interblocage()
+{
+	if (stats != NULL)
+		__atomic_add_fetch(&stats->interblocages, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * \fn void stats_evitement()
+ * \brief Compte une decision refusee par l'evitement des interblocages.
+ */
+void stats_evitement()
+{
+	if (stats != NULL)
+		__atomic_add_fetch(&stats->evitements, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * \fn void stats_phase()
+ * \brief Compte un changement de phase des feux d'un carrefour.
+ */
+void stats_phase()
+{
+	if (stats != NULL)
+		__atomic_add_fetch(&stats->phases, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * \fn long long centile_classes(long long *histogramme, long long n, double p)
+ * \brief Estime le centile p (0<p<1) d'un histogramme de n attentes : borne superieure de la classe qui le contient.
+ */
+long long centile_classes(long long *histogramme, long long n, double p)
+{
+	long long cumul = 0;
+	int k;
+
+	for (k=0;k<NB_CLASSES;k++) {
+		cumul += histogramme[k];
+		if (cumul >= p * n)
+			return k == 0 ? 0 : 1LL << k;
+	}
+	return 1LL << (NB_CLASSES-1);
+}
+
+/**
+ * \fn void centiles_attentes(Statistiques *s, long long *p50, long long *p99, long long *p99_max)
+ * \brief Estime les centiles des attentes de toutes les demandes de la grille, et la pire attente p99 d'un croisement (par etape et orientation).
+ *
+ * \param s Pointeur sur les statistiques.
+ * \param p50 Pointeur sur l'attente p50 de toutes les demandes (en microseconde).
+ * \param p99 Pointeur sur l'attente p99 de toutes les demandes.
+ * \param p99_max Pointeur sur la plus grande attente p99 des lignes de affiche_statistiques().
+ */
+void centiles_attentes(Statistiques *s, long long *p50, long long *p99, long long *p99_max)
+{
+	StatsCroisement *sc;
+	long long histogramme[NB_CLASSES], total[NB_CLASSES] = {0}, accords, n = 0, p;
+	int c, j, t, o, k;
+
+	*p99_max = 0;
+	for (c=0;c<s->nb_carrefours;c++) {
+		for (j=0;j<25;j++) {
+			sc = &s->croisements[c][j];
+			for (t=0;t<3;t++) {
+				for (o=0;o<2;o++) {
+					accords = __atomic_load_n(&sc->accords[t][o], __ATOMIC_RELAXED);
+					if (accords == 0)
+						continue;
+					for (k=0;k<NB_CLASSES;k++) {
+						histogramme[k] = __atomic_load_n(&sc->histogramme[t][o][k], __ATOMIC_RELAXED);
+						total[k] += histogramme[k];
+					}
+					n += accords;
+					p = centile_classes(histogramme, accords, 0.99);
+					if (p > *p99_max)
+						*p99_max = p;
+				}
+			}
+		}
+	}
+
+	*p50 = n > 0 ? centile_classes(total, n, 0.5) : 0;
+	*p99 = n > 0 ? centile_classes(total, n, 0.99) : 0;
+}
+
+/**
+ * \fn void affiche_statistiques(Statistiques *s, FILE *f)
+ * \brief Affiche une ligne par croisement, etape et orientation ayant recu des demandes.
+ *
+ * Les attentes p50 / p99 sont estimees par les bornes superieures des classes des histogrammes.
+ * Les compteurs d'interblocages detectes, de decisions refusees par l'evitement et de changements de phase des feux suivent le tableau.
+ *
+ * \param s Pointeur sur les statistiques (eventuellement en cours de mise a jour).
+ * \param f Le flux de sortie.
+ */
+void affiche_statistiques(Statistiques *s, FILE *f)
+{
+	StatsCroisement *sc;
+	long long histogramme[NB_CLASSES], accords, refus, attente;
+	int c, j, t, o, k;
+
+	fprintf(f, "carrefour croisement etape   orientation    accords      refus  attente_moy_us    p50_us    p99_us\n");
+	for (c=0;c<s->nb_carrefours;c++) {
+		for (j=0;j<25;j++) {
+			sc = &s->croisements[c][j];
+			for (t=0;t<3;t++) {
+				for (o=0;o<2;o++) {
+					accords = __atomic_load_n(&sc->accords[t][o], __ATOMIC_RELAXED);
+					refus = __atomic_load_n(&sc->refus[t][o], __ATOMIC_RELAXED);
+					if (accords == 0 && refus == 0)
+						continue;
+					attente = __atomic_load_n(&sc->attente[t][o], __ATOMIC_RELAXED);
+					for (k=0;k<NB_CLASSES;k++)
+						histogramme[k] = __atomic_load_n(&sc->histogramme[t][o][k], __ATOMIC_RELAXED);
+
+					fprintf(f, "%9d %10d %-7s %11s %10lld %10lld %15lld %9lld %9lld\n", c+1, j, noms_etapes[t], noms_orientations[o], accords, refus,
+							accords > 0 ? attente / accords : 0, centile_classes(histogramme, accords, 0.5), centile_classes(histogramme, accords, 0.99));
+				}
+			}
+		}
+	}
+	fprintf(f, "interblocages %lld evitements %lld phases %lld\n", __atomic_load_n(&s->interblocages, __ATOMIC_RELAXED), __atomic_load_n(&s->evitements, __ATOMIC_RELAXED), __atomic_load_n(&s->phases, __ATOMIC_RELAXED));
+	fflush(f);
+}
+
+/**
+ * \fn void supprime_statistiques()
+ * \brief Detache et supprime le segment de memoire partagee des statistiques.
+ */
+void supprime_statistiques()
+{
+	if (statistiques == -1)
+		return;
+
+	shmdt(stats);
+	shmctl(statistiques, IPC_RMID, NULL);
+	stats = NULL;
+	statistiques = -1;
+}
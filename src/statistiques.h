@@ -0,0 +1,59 @@
+#ifndef __STATISTIQUES__
+#define __STATISTIQUES__
+
+#include <stdio.h>
+#include "project.h"
+
+/*! Le nombre de classes des histogrammes d'attente. La classe 0 compte les attentes nulles, la classe k (k>0) les attentes de [2^(k-1), 2^k[ microsecondes. */
+#define NB_CLASSES 32
+
+/**
+ * \struct StatsCroisement
+ * \brief Represente les statistiques d'un croisement, par etape (AVANT, PENDANT, APRES) et par orientation (HO, VE).
+ *
+ * L'attente d'une demande est la duree entre son emission et son autorisation. Une demande refusee (mise en attente ou redemandee) n'est comptee qu'une fois.
+ */
+typedef struct StatsCroisement {
+	long long accords[3][2];	/*!< Le nombre de demandes autorisees. */
+	long long refus[3][2];	/*!< Le nombre de demandes qui ont du attendre (refusees au moins une fois). */
+	long long attente[3][2];	/*!< La somme des attentes (en microseconde). */
+	long long histogramme[3][2][NB_CLASSES];	/*!< La repartition des attentes (voir NB_CLASSES). */
+} StatsCroisement;
+
+/**
+ * \struct Statistiques
+ * \brief Represente les statistiques de tous les croisements, dans un segment de memoire partagee (a cote des carrefours).
+ */
+typedef struct Statistiques {
+	long long nb_carrefours;	/*!< Le nombre de carrefours de la grille. */
+	long long interblocages;	/*!< Le nombre d'interblocages detectes (cycles de cases pleines, voir detecte_interblocage()). */
+	long long evitements;	/*!< Le nombre de decisions refusees par l'evitement des interblocages alors que la place etait libre (option "-e"). */
+	long long phases;	/*!< Le nombre de changements de phase des feux (option "-c"). */
+	StatsCroisement croisements[][25];	/*!< Les statistiques de chaque croisement de chaque carrefour. */
+} Statistiques;
+
+/*! La taille du segment des statistiques pour une grille de nb carrefours. */
+#define TAILLE_STATISTIQUES(nb) (sizeof(Statistiques) + (nb) * 25 * sizeof(StatsCroisement))
+
+extern int statistiques;	/*!< Le segment de memoire partagee des statistiques. */
+extern Statistiques *stats;	/*!< Les statistiques, attachees une seule fois avant les fork (NULL si elles n'existent pas). */
+
+void initialise_statistiques(int nb);
+
+void stats_accord(Requete *req, long long attente);
+
+void stats_refus(Requete *req);
+
+void stats_interblocage();
+
+void stats_evitement();
+
+void stats_phase();
+
+void centiles_attentes(Statistiques *s, long long *p50, long long *p99, long long *p99_max);
+
+void affiche_statistiques(Statistiques *s, FILE *f);
+
+void supprime_statistiques();
+
+#endif
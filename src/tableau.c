@@ -0,0 +1,245 @@
+/**
+ * \file tableau.c
+ * \brief Programme annexe : tableau de bord des carrefours d'une simulation en cours, redessine a cadence fixe dans le terminal.
+ *
+ * Syntaxe : "./tableau segment" ou "./tableau segment colonnes [images]" (colonnes de carrefours par rangee, 2 par defaut ; images par seconde, 10 par defaut).
+ * Le numero du segment des carrefours est affiche au lancement de la simulation ("Carrefours : segment N"). Le segment est attache en lecture seule : l'observation ne prend aucun verrou et n'envoie aucun message, quel que soit le nombre de voitures.
+ *
+ * A chaque image, le segment est copie d'un bloc (cliche), puis l'ecran est reconstruit a partir du cliche. Seules les lignes qui different de l'image precedente sont reecrites (sequences ANSI de positionnement du curseur).
+ * Les totaux de la grille et de chaque carrefour sont calcules sur un releve rang par rang du cliche (voir occupation.c).
+ * L'ecran est borne a LIGNES_ECRAN lignes et LARGEUR_ECRAN caracteres : sur une grande grille, seules les premieres rangees de carrefours sont dessinees, et l'image l'indique (les totaux de la grille restent complets).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/types.h>
+#include "project.h"
+#include "occupation.h"
+
+/*! Le nombre maximal de lignes de l'ecran du tableau de bord. */
+#define LIGNES_ECRAN 200
+/*! Le nombre maximal de caracteres d'une ligne de l'ecran. */
+#define LARGEUR_ECRAN 256
+/*! La largeur d'un carrefour a l'ecran : 5 cases de 4 caracteres et une marge. */
+#define LARGEUR_CARREFOUR 23
+/*! La hauteur d'un carrefour a l'ecran : un titre, 5 rangees de croisements et une ligne vide. */
+#define HAUTEUR_CARREFOUR 7
+/*! Le nombre maximal de rangees de carrefours a l'ecran (sous les 5 lignes d'en-tete). */
+#define RANGEES_ECRAN ((LIGNES_ECRAN - 5) / HAUTEUR_CARREFOUR)
+/*! Le nombre maximal de carrefours par rangee a l'ecran. */
+#define COLONNES_ECRAN ((LARGEUR_ECRAN - 1) / LARGEUR_CARREFOUR)
+
+/*! L'ecran de l'image en cours de construction. */
+char ecran[LIGNES_ECRAN][LARGEUR_ECRAN];
+/*! L'ecran de l'image precedente, tel qu'affiche dans le terminal. */
+char affiche[LIGNES_ECRAN][LARGEUR_ECRAN];
+/*! Le releve des compteurs du cliche, pour les totaux. */
+Occupation occupation;
+
+int construit_ecran(Carrefour *cliche, int nombre, int colonnes, long long image);
+
+void dessine_carrefour(Carrefour *c, int numero, int ligne, int colonne);
+
+void ecrit(int ligne, int colonne, char *texte);
+
+void affiche_differences(int lignes);
+
+/**
+ * \fn int main(int argc, char* argv[])
+ * \brief Attache le segment des carrefours en lecture seule et redessine le tableau de bord a cadence fixe, jusqu'a la fin de la simulation.
+ */
+int main(int argc, char* argv[])
+{
+	Carrefour *reseau, *cliche;
+	struct shmid_ds infos;
+	struct timespec echeance;
+	int segment, nombre, colonnes = 2, images = 10, lignes;
+	long long image = 0;
+
+	if (argc != 2 && argc != 3 && argc != 4) {
+		printf("Syntaxe : ""./tableau segment"" OU ""./tableau segment colonnes [images]"".\n");
+		exit(-1);
+	}
+
+	segment = atoi(argv[1]);
+	if (argc >= 3 && atoi(argv[2]) > 0)
+		colonnes = atoi(argv[2]) < COLONNES_ECRAN ? atoi(argv[2]) : COLONNES_ECRAN;
+	if (argc == 4 && atoi(argv[3]) > 0)
+		images = atoi(argv[3]);
+
+	if (shmctl(segment, IPC_STAT, &infos) == -1 || infos.shm_segsz == 0 || infos.shm_segsz % sizeof(Carrefour) != 0) {
+		printf("%s n'est pas un segment de carrefours.\n", argv[1]);
+		exit(-1);
+	}
+	nombre = infos.shm_segsz / sizeof(Carrefour);
+
+	reseau = shmat(segment, NULL, SHM_RDONLY);
+	if (reseau == (void *) -1) {
+		perror("Pb shmat carrefours");
+		exit(1);
+	}
+
+	cliche = malloc(infos.shm_segsz);
+	if (cliche == NULL) {
+		perror("Pb malloc cliche");
+		exit(1);
+	}
+
+	initialise_occupation(&occupation, nombre);
+	memset(affiche, 0, sizeof(affiche));
+	printf("\033[2J\033[?25l");
+	clock_gettime(CLOCK_MONOTONIC, &echeance);
+
+	while (1) {
+		memcpy(cliche, reseau, infos.shm_segsz);
+		lignes = construit_ecran(cliche, nombre, colonnes, image++);
+		affiche_differences(lignes);
+
+		echeance.tv_nsec += 1000000000L / images;
+		if (echeance.tv_nsec >= 1000000000L) {
+			echeance.tv_sec++;
+			echeance.tv_nsec -= 1000000000L;
+		}
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &echeance, NULL);
+
+		/* La simulation a supprime le segment : il n'est plus attache que par ce programme. */
+		if (shmctl(segment, IPC_STAT, &infos) == -1 || infos.shm_nattch <= 1)
+			break;
+	}
+
+	printf("\033[%d;1H\033[?25h", lignes + 1);
+	detruit_occupation(&occupation);
+	free(cliche);
+	shmdt(reseau);
+	return 0;
+}
+
+/**
+ * \fn int construit_ecran(Carrefour *cliche, int nombre, int colonnes, long long image)
+ * \brief Construit l'image du tableau de bord a partir d'un cliche des carrefours.
+ *
+ * Au dela de RANGEES_ECRAN rangees, les carrefours suivants ne sont pas dessines : la ligne 5 de l'image indique alors ceux qui sont affiches.
+ *
+ * \param cliche Les carrefours copies du segment.
+ * \param nombre Le nombre de carrefours.
+ * \param colonnes Le nombre de carrefours par rangee.
+ * \param image Le numero de l'image.
+ *
+ * \return Le nombre de lignes de l'image.
+ */
+int construit_ecran(Carrefour *cliche, int nombre, int colonnes, long long image)
+{
+	char texte[LARGEUR_ECRAN];
+	Metriques m;
+	int i, visibles = RANGEES_ECRAN * colonnes;
+
+	memset(ecran, 0, sizeof(ecran));
+	releve_occupation(&occupation, cliche);
+	metriques_reseau(&occupation, &m);
+
+	snprintf(texte, sizeof(texte), "Tableau de bord : %d carrefours, image %lld", nombre, image);
+	ecrit(0, 0, texte);
+	if (m.plus_charge == -1)
+		snprintf(texte, sizeof(texte), "Grille : %lld avant, %d croisements occupes, %lld apres", m.avant, m.occupes, m.apres);
+	else
+		snprintf(texte, sizeof(texte), "Grille : %lld avant, %d croisements occupes, %lld apres ; plus charge : #%d croisement %d (%d)",
+			m.avant, m.occupes, m.apres, m.plus_charge / PAS_OCCUPATION + 1, m.plus_charge % PAS_OCCUPATION, m.charge_max);
+	ecrit(1, 0, texte);
+	ecrit(2, 0, "Titre : #carrefour avant/croisements/apres [Fphase, * en degagement]");
+	ecrit(3, 0, "Case : file avant H, etat (. libre, - traverse H, | traverse V), file avant V");
+
+	if (nombre > visibles) {
+		snprintf(texte, sizeof(texte), "Ecran limite a %d lignes : carrefours 1 a %d sur %d affiches", LIGNES_ECRAN, visibles, nombre);
+		ecrit(4, 0, texte);
+	} else {
+		visibles = nombre;
+	}
+
+	for (i=0;i<visibles;i++)
+		dessine_carrefour(&cliche[i], i+1, 5 + (i / colonnes) * HAUTEUR_CARREFOUR, (i % colonnes) * LARGEUR_CARREFOUR);
+
+	return 5 + ((visibles + colonnes - 1) / colonnes) * HAUTEUR_CARREFOUR;
+}
+
+/**
+ * \fn void dessine_carrefour(Carrefour *c, int numero, int ligne, int colonne)
+ * \brief Dessine un carrefour dans l'image : son titre (totaux des files et croisements occupes du releve, phase des feux) et ses 5 x 5 croisements.
+ *
+ * \param c Pointeur sur le carrefour (dans le cliche).
+ * \param numero Le numero du carrefour.
+ * \param ligne La ligne de l'ecran du titre.
+ * \param colonne La colonne de l'ecran du carrefour.
+ */
+void dessine_carrefour(Carrefour *c, int numero, int ligne, int colonne)
+{
+	char texte[LARGEUR_CARREFOUR + 1], etat;
+	Metriques m;
+	Croisement *x;
+	int i;
+
+	metriques_carrefour(&occupation, numero, &m);
+
+	if (c->feu != 0)
+		snprintf(texte, sizeof(texte), "#%d %lld/%d/%lld F%d%s", numero, m.avant, m.occupes, m.apres, (int) (c->feu & 0xF), (c->feu >> 4) & 1 ? "*" : "");
+	else
+		snprintf(texte, sizeof(texte), "#%d %lld/%d/%lld", numero, m.avant, m.occupes, m.apres);
+	ecrit(ligne, colonne, texte);
+
+	for (i=0;i<25;i++) {
+		x = &c->croisements[i];
+		if (x->etat == -1)
+			continue;
+
+		if (x->etat == 0)
+			etat = '.';
+		else
+			etat = x->occupant == HO ? '-' : '|';
+		snprintf(texte, sizeof(texte), "%c%c%c", x->avantH > 9 ? '+' : '0' + x->avantH, etat, x->avantV > 9 ? '+' : '0' + x->avantV);
+		ecrit(ligne + 1 + i / 5, colonne + (i % 5) * 4, texte);
+	}
+}
+
+/**
+ * \fn void ecrit(int ligne, int colonne, char *texte)
+ * \brief Ecrit un texte dans l'image a une position donnee (tronque aux bords de l'ecran).
+ *
+ * \param ligne La ligne de l'ecran.
+ * \param colonne La colonne de l'ecran.
+ * \param texte Le texte.
+ */
+void ecrit(int ligne, int colonne, char *texte)
+{
+	int k;
+
+	if (ligne >= LIGNES_ECRAN)
+		return;
+
+	for (k=0;k<colonne && k<LARGEUR_ECRAN-1;k++)
+		if (ecran[ligne][k] == '\0')
+			ecran[ligne][k] = ' ';
+
+	for (k=0;texte[k] != '\0' && colonne+k < LARGEUR_ECRAN-1;k++)
+		ecran[ligne][colonne+k] = texte[k];
+}
+
+/**
+ * \fn void affiche_differences(int lignes)
+ * \brief Reecrit dans le terminal les lignes de l'image qui different de l'image precedente, en une seule ecriture.
+ *
+ * \param lignes Le nombre de lignes de l'image.
+ */
+void affiche_differences(int lignes)
+{
+	int l;
+
+	for (l=0;l<lignes;l++) {
+		if (strcmp(ecran[l], affiche[l]) == 0)
+			continue;
+		printf("\033[%d;1H%s\033[K", l+1, ecran[l]);
+		strcpy(affiche[l], ecran[l]);
+	}
+	fflush(stdout);
+}
@@ -0,0 +1,123 @@
+/**
+ * \file topologie.c
+ * \brief Contient la topologie de la carte : une grille de lignes x colonnes carrefours, chargee au lancement (option "-g").
+ *
+ * Les carrefours sont numerotes ligne par ligne a partir de 1 : le carrefour de la ligne l et de la colonne c (a partir de 0) porte le numero l*colonnes+c+1.
+ * Sans fichier de topologie, la grille fait 2 x 2 carrefours (la carte historique).
+ *
+ * Format du fichier (une directive par ligne, "#" commence un commentaire) :
+ * - "grille L C" : la grille fait L lignes et C colonnes.
+ * - "ferme N D" : ferme la route qui sort du carrefour N dans la direction D (N, E, S ou O), dans les deux sens. Les voitures qui l'empruntent quittent la carte.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "project.h"
+#include "main.h"
+#include "topologie.h"
+
+int lignes = 2;
+int colonnes = 2;
+int nb_carrefours = 4;
+int *voisins = NULL;
+
+/*! Les routes fermees par le fichier de topologie (carrefour, direction), appliquees par initialise_topologie(). */
+int *fermetures = NULL;
+/*! Le nombre de routes fermees. */
+int nb_fermetures = 0;
+
+/**
+ * \fn void charge_topologie(char *chemin)
+ * \brief Lit un fichier de topologie.
+ *
+ * Quitte le programme si le fichier est invalide.
+ *
+ * \param chemin Le chemin du fichier de topologie.
+ */
+void charge_topologie(char *chemin)
+{
+	FILE *f;
+	char ligne[256], directive[16], direction;
+	int numero = 0, carrefour, capacite = 0;
+
+	f = fopen(chemin, "r");
+	if (f == NULL)
+		erreurFin("Pb ouverture topologie");
+
+	while (fgets(ligne, sizeof(ligne), f) != NULL) {
+		numero++;
+		if (strchr(ligne, '#') != NULL)
+			*strchr(ligne, '#') = '\0';
+		if (sscanf(ligne, "%15s", directive) != 1)
+			continue;
+
+		if (strcmp(directive, "grille") == 0 && sscanf(ligne, "%*s %d %d", &lignes, &colonnes) == 2 && lignes > 0 && colonnes > 0 && lignes <= 1024 && colonnes <= 1024) {
+			nb_carrefours = lignes * colonnes;
+		} else if (strcmp(directive, "ferme") == 0 && sscanf(ligne, "%*s %d %c", &carrefour, &direction) == 2 && strchr("NESO", direction) != NULL) {
+			if (nb_fermetures == capacite) {
+				capacite = capacite == 0 ? 16 : capacite * 2;
+				fermetures = realloc(fermetures, capacite * 2 * sizeof(int));
+				if (fermetures == NULL)
+					erreurFin("Pb realloc topologie");
+			}
+			fermetures[nb_fermetures*2] = carrefour;
+			fermetures[nb_fermetures*2+1] = strchr("NESO", direction) - "NESO";
+			nb_fermetures++;
+		} else {
+			printf("%s, ligne %d : directive invalide (""grille L C"" ou ""ferme N D"" attendu, D valant N, E, S ou O).\n", chemin, numero);
+			exit(-1);
+		}
+	}
+
+	fclose(f);
+}
+
+/**
+ * \fn void initialise_topologie()
+ * \brief Construit la table des voisins de la grille, puis applique les fermetures de routes.
+ *
+ * Quitte le programme si une fermeture designe un carrefour hors de la grille.
+ */
+void initialise_topologie()
+{
+	int i, l, c, d, inverse[] = {SUD, OUEST, NORD, EST};
+
+	voisins = malloc(nb_carrefours * 4 * sizeof(int));
+	if (voisins == NULL)
+		erreurFin("Pb malloc topologie");
+
+	for (i=0;i<nb_carrefours;i++) {
+		l = i / colonnes;
+		c = i % colonnes;
+		voisins[i*4+NORD] = l > 0 ? i - colonnes + 1 : -1;
+		voisins[i*4+EST] = c < colonnes-1 ? i + 2 : -1;
+		voisins[i*4+SUD] = l < lignes-1 ? i + colonnes + 1 : -1;
+		voisins[i*4+OUEST] = c > 0 ? i : -1;
+	}
+
+	for (i=0;i<nb_fermetures;i++) {
+		c = fermetures[i*2];
+		d = fermetures[i*2+1];
+		if (c < 1 || c > nb_carrefours) {
+			printf("Fermeture invalide : le carrefour %d n'existe pas (1 a %d).\n", c, nb_carrefours);
+			exit(-1);
+		}
+		if (voisins[(c-1)*4+d] != -1)
+			voisins[(voisins[(c-1)*4+d]-1)*4+inverse[d]] = -1;
+		voisins[(c-1)*4+d] = -1;
+	}
+}
+
+/**
+ * \fn int carrefour_suivant(int carrefour, int voie)
+ * \brief Retourne le carrefour sur lequel debouche une voie.
+ *
+ * \param carrefour Le numero du carrefour.
+ * \param voie Le numero de la voie (de 1 a 12), qui sort dans la direction (voie-1)%4.
+ *
+ * \return Le numero du carrefour suivant, -1 si la voie quitte la carte.
+ */
+int carrefour_suivant(int carrefour, int voie)
+{
+	return voisins[(carrefour-1)*4 + (voie-1)%4];
+}
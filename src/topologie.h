@@ -0,0 +1,16 @@
+#ifndef __TOPOLOGIE__
+#define __TOPOLOGIE__
+
+#include "project.h"
+
+extern int lignes;	/*!< Le nombre de lignes de la grille de carrefours. */
+extern int colonnes;	/*!< Le nombre de colonnes de la grille de carrefours. */
+extern int *voisins;	/*!< Le carrefour voisin de chaque carrefour dans chaque direction (voisins[(carrefour-1)*4+direction], -1 : sortie de la carte). */
+
+void charge_topologie(char *chemin);
+
+void initialise_topologie();
+
+int carrefour_suivant(int carrefour, int voie);
+
+#endif
@@ -0,0 +1,180 @@
+/**
+ * \file trace.c
+ * \brief Enregistre les requetes et reponses des voitures dans une trace binaire (option "-T").
+ *
+ * La trace est un fichier projete en memoire (partage par tous les processus fils et tous les threads) : un entete suivi d'evenements de taille fixe.
+ * Chaque emetteur reserve sa case par un increment atomique du nombre d'evenements, sans verrou ni appel systeme.
+ * La projection reserve l'espace d'adresses de CAPACITE_TRACE evenements, mais le fichier n'est agrandi qu'a la demande (par doublement) :
+ * l'emetteur qui depasse la capacite agrandit le fichier sous le verrou de l'entete, les autres attendent la fin de l'agrandissement.
+ * Le programme rendu relit la trace apres coup pour produire l'affichage en colonnes ou un fichier CSV.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include "project.h"
+#include "main.h"
+#include "trace.h"
+
+/*! L'entete de la trace projetee en memoire (NULL si la trace n'est pas activee). */
+EnteteTrace *trace_entete = NULL;
+/*! Les evenements de la trace, a la suite de l'entete. */
+EvenementTrace *trace_evenements;
+/*! Le descripteur du fichier de trace. */
+int trace_fd = -1;
+/*! Le nombre d'evenements couverts par la projection (capacite maximale du fichier). */
+long long trace_reserve;
+/*! La date virtuelle des evenements (moteur a evenements discrets), -1 pour utiliser l'horloge reelle. */
+long long trace_virtuelle = -1;
+
+/**
+ * \fn void ouvre_trace(char *chemin)
+ * \brief Cree le fichier de trace et le projette en memoire partagee.
+ *
+ * Doit etre appele avant la creation des processus fils pour que la projection soit heritee.
+ *
+ * \param chemin Le chemin du fichier de trace.
+ */
+void ouvre_trace(char *chemin)
+{
+	struct timespec t;
+
+	trace_fd = open(chemin, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (trace_fd == -1)
+		erreurFin("Pb open trace");
+	if (ftruncate(trace_fd, sizeof(EnteteTrace) + TRANCHE_TRACE * sizeof(EvenementTrace)) == -1)
+		erreurFin("Pb ftruncate trace");
+
+	/* Seul l'espace d'adresses est reserve : les pages au dela de la fin du fichier ne sont touchees qu'apres son agrandissement. */
+	for (trace_reserve = CAPACITE_TRACE; trace_reserve >= TRANCHE_TRACE; trace_reserve /= 2) {
+		trace_entete = mmap(NULL, sizeof(EnteteTrace) + trace_reserve * sizeof(EvenementTrace), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE, trace_fd, 0);
+		if (trace_entete != MAP_FAILED)
+			break;
+	}
+	if (trace_entete == MAP_FAILED)
+		erreurFin("Pb mmap trace");
+	trace_evenements = (EvenementTrace *) (trace_entete + 1);
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	memcpy(trace_entete->magique, MAGIQUE_TRACE, 8);
+	trace_entete->version = VERSION_TRACE;
+	trace_entete->taille = sizeof(EvenementTrace);
+	trace_entete->capacite = TRANCHE_TRACE;
+	trace_entete->nombre = 0;
+	trace_entete->perdus = 0;
+	trace_entete->agrandissement = 0;
+	trace_entete->origine = (long long) t.tv_sec * 1000000 + t.tv_nsec / 1000;
+}
+
+/**
+ * \fn int agrandit_trace(long long n)
+ * \brief Attend que le fichier de trace contienne la case n, en l'agrandissant si necessaire.
+ *
+ * Un seul emetteur (tous processus confondus) agrandit le fichier a la fois : il double sa capacite sous le verrou de l'entete.
+ *
+ * \param n L'indice de la case reservee.
+ * \return 1 si la case est disponible, 0 si le fichier ne peut plus etre agrandi.
+ */
+int agrandit_trace(long long n)
+{
+	long long capacite;
+	int libre;
+
+	while (n >= (capacite = __atomic_load_n(&trace_entete->capacite, __ATOMIC_ACQUIRE))) {
+		if (n >= trace_reserve)
+			return 0;
+		libre = 0;
+		if (!__atomic_compare_exchange_n(&trace_entete->agrandissement, &libre, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+			sched_yield();
+			continue;
+		}
+		if (__atomic_load_n(&trace_entete->capacite, __ATOMIC_RELAXED) == capacite) {
+			capacite = capacite * 2 < trace_reserve ? capacite * 2 : trace_reserve;
+			if (ftruncate(trace_fd, sizeof(EnteteTrace) + capacite * sizeof(EvenementTrace)) == -1) {
+				__atomic_store_n(&trace_entete->agrandissement, 0, __ATOMIC_RELEASE);
+				return 0;
+			}
+			__atomic_store_n(&trace_entete->capacite, capacite, __ATOMIC_RELEASE);
+		}
+		__atomic_store_n(&trace_entete->agrandissement, 0, __ATOMIC_RELEASE);
+	}
+
+	return 1;
+}
+
+/**
+ * \fn void trace_requete(Requete *req, int autorisation)
+ * \brief Ajoute un evenement a la trace (ne fait rien si la trace n'est pas activee).
+ *
+ * \param req Pointeur sur la requete concernee.
+ * \param autorisation La reponse a la demande (1 / 0), ou -1 s'il s'agit de la requete elle meme.
+ */
+void trace_requete(Requete *req, int autorisation)
+{
+	EvenementTrace *e;
+	struct timespec t;
+	long long n;
+
+	if (trace_entete == NULL)
+		return;
+
+	n = __atomic_fetch_add(&trace_entete->nombre, 1, __ATOMIC_RELAXED);
+	if (!agrandit_trace(n)) {
+		__atomic_fetch_add(&trace_entete->perdus, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	e = &trace_evenements[n];
+	if (trace_virtuelle >= 0) {
+		e->date = trace_virtuelle;
+	} else {
+		clock_gettime(CLOCK_MONOTONIC, &t);
+		e->date = (long long) t.tv_sec * 1000000 + t.tv_nsec / 1000 - trace_entete->origine;
+	}
+	e->voiture = req->voiture;
+	e->carrefour = req->carrefour;
+	e->croisement = req->croisement;
+	e->orientation = req->croisement_orientation;
+	e->traverse = req->traverse;
+	e->type = req->type;
+	e->autorisation = autorisation;
+	e->voie = req->voie;
+	e->reserve[0] = e->reserve[1] = 0;
+}
+
+/**
+ * \fn void trace_date_virtuelle(long long date)
+ * \brief Fixe la date des prochains evenements de la trace (temps virtuel du moteur a evenements discrets).
+ *
+ * \param date La date virtuelle (en microseconde).
+ */
+void trace_date_virtuelle(long long date)
+{
+	trace_virtuelle = date;
+}
+
+/**
+ * \fn void ferme_trace()
+ * \brief Ramene le fichier de trace a sa taille utile et le ferme.
+ */
+void ferme_trace()
+{
+	long long nombre;
+
+	if (trace_entete == NULL)
+		return;
+
+	nombre = trace_entete->nombre;
+	if (nombre > trace_entete->capacite)
+		nombre = trace_entete->capacite;
+	trace_entete->nombre = nombre;
+
+	munmap(trace_entete, sizeof(EnteteTrace) + trace_reserve * sizeof(EvenementTrace));
+	ftruncate(trace_fd, sizeof(EnteteTrace) + nombre * sizeof(EvenementTrace));
+	close(trace_fd);
+	trace_entete = NULL;
+}
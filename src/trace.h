@@ -0,0 +1,58 @@
+#ifndef __TRACE__
+#define __TRACE__
+
+#include "project.h"
+
+/*! La signature placee en tete des fichiers de trace. */
+#define MAGIQUE_TRACE "CARTRACE"
+/*! La version du format des fichiers de trace. */
+#define VERSION_TRACE 2
+/*! Le nombre maximal d'evenements d'un fichier de trace : taille de l'espace d'adresses reserve par la projection (divisee par deux tant que mmap echoue). */
+#define CAPACITE_TRACE (1LL << 36)
+/*! La capacite initiale du fichier de trace, en evenements (elle double a chaque agrandissement). */
+#define TRANCHE_TRACE (1LL << 20)
+
+/**
+ * \struct EnteteTrace
+ * \brief Represente l'entete d'un fichier de trace (64 octets).
+ */
+typedef struct EnteteTrace {
+	char magique[8];	/*!< La signature MAGIQUE_TRACE. */
+	int version;	/*!< La version du format (VERSION_TRACE). */
+	int taille;	/*!< La taille d'un evenement (sizeof(EvenementTrace)). */
+	long long capacite;	/*!< Le nombre d'evenements alloues dans le fichier (agrandi a la demande). */
+	long long nombre;	/*!< Le nombre d'evenements reserves (incremente atomiquement par les emetteurs). */
+	long long perdus;	/*!< Le nombre d'evenements perdus (agrandissement du fichier impossible). */
+	long long origine;	/*!< La date de debut de la trace (horloge monotone, en microseconde). */
+	int agrandissement;	/*!< Le verrou d'agrandissement du fichier (1 pendant un agrandissement, 0 sinon). */
+	char reserve[12];	/*!< Reserve, complete l'entete a 64 octets. */
+} EnteteTrace;
+
+/**
+ * \struct EvenementTrace
+ * \brief Represente un evenement de la trace binaire (24 octets).
+ *
+ * Un evenement correspond a une requete d'une voiture (autorisation vaut -1) ou a la reponse a une demande (autorisation vaut 1 ou 0).
+ */
+typedef struct EvenementTrace {
+	long long date;	/*!< La date de l'evenement depuis le debut de la trace (en microseconde). */
+	int voiture;	/*!< Le numero de la voiture. */
+	int carrefour;	/*!< Le numero du carrefour. */
+	signed char croisement;	/*!< L'indice du croisement (-1 si aucun). */
+	signed char orientation;	/*!< L'orientation du croisement (HO / VE, -1 si aucun). */
+	signed char traverse;	/*!< L'etat de traversement (AVANT / PENDANT / APRES, -1 si aucun). */
+	signed char type;	/*!< Le type de requete (MESSARRIVE, MESSDEMANDE, MESSINFO, MESSSORT). */
+	signed char autorisation;	/*!< La reponse a une demande (1 / 0), -1 pour une requete. */
+	signed char voie;	/*!< Le numero de la voie de la requete. */
+	signed char reserve[2];	/*!< Reserve, complete l'evenement a 24 octets. */
+} EvenementTrace;
+
+void ouvre_trace(char *chemin);
+
+void trace_requete(Requete *req, int autorisation);
+
+void trace_date_virtuelle(long long date);
+
+void ferme_trace();
+
+#endif
@@ -0,0 +1,111 @@
+/**
+ * \file transport.c
+ * \brief Contient l'interface de transport des requetes et des reponses, et son implementation par files de message SysV.
+ *
+ * Les voitures, les carrefours et le serveur ne communiquent que par le transport choisi au lancement (option "-r" : anneaux en memoire partagee, voir anneau.c).
+ * Avec les files SysV, chaque file porte a la fois les requetes (type : MESSARRIVE a MESSRESERVE, ou pid du serveur) et les reponses (type : pid du destinataire).
+ * Une file SysV ne peut pas etre attendue avec une limite de temps : une attente limitee est une scrutation (au plus toutes les MINPAUSE microsecondes).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/ipc.h>
+#include <sys/msg.h>
+#include <sys/types.h>
+#include "project.h"
+#include "transport.h"
+
+int envoie_requete_files(int file, Message *m, int bloquant);
+
+int recoit_requete_files(int file, Message *m, long long attente);
+
+int depose_reponse_files(int file, int client, Reponse *rep, int bloquant);
+
+void attend_reponse_files(int file, int client, Reponse *rep);
+
+Transport transport_files = {"files", envoie_requete_files, recoit_requete_files, depose_reponse_files, attend_reponse_files};
+Transport *transport = &transport_files;
+
+/**
+ * \fn void initialise_transport(int nbVoitures)
+ * \brief Prepare le transport choisi : les files SysV sont creees par initialise_files(), les anneaux sont crees ici.
+ *
+ * \param nbVoitures Le nombre de voitures de la simulation.
+ */
+void initialise_transport(int nbVoitures)
+{
+	if (transport == &transport_anneaux)
+		initialise_anneaux(nb_carrefours + 1, nbVoitures);
+}
+
+/**
+ * \fn int client_voiture(int numero)
+ * \brief Retourne le client correspondant a une voiture (destinataire des reponses de son carrefour).
+ */
+int client_voiture(int numero)
+{
+	return numero;
+}
+
+/**
+ * \fn void supprime_transport()
+ * \brief Supprime les objets du transport choisi (les files SysV sont supprimees par supprime_ipc()).
+ */
+void supprime_transport()
+{
+	if (transport == &transport_anneaux)
+		supprime_anneaux();
+}
+
+/**
+ * \fn int file_sysv(int file)
+ * \brief Retourne l'identifiant de la file de message SysV d'une file du transport.
+ */
+int file_sysv(int file)
+{
+	return file == FILE_SERVEUR ? msg_serveur : msg_carrefour[file-1];
+}
+
+/**
+ * \fn int envoie_requete_files(int file, Message *m, int bloquant)
+ * \brief Depose une requete dans une file SysV, avec le type du message.
+ */
+int envoie_requete_files(int file, Message *m, int bloquant)
+{
+	return msgsnd(file_sysv(file),m,tailleReq,bloquant ? 0 : IPC_NOWAIT);
+}
+
+/**
+ * \fn int recoit_requete_files(int file, Message *m, long long attente)
+ * \brief Retire la requete suivante d'une file SysV.
+ *
+ * Le serveur ne lit que les messages a son pid ; un carrefour ne lit que les types 1 a MESSRESERVE, jamais les reponses destinees aux voitures.
+ */
+int recoit_requete_files(int file, Message *m, long long attente)
+{
+	long type = file == FILE_SERVEUR ? getpid() : -MESSRESERVE;
+
+	if (msgrcv(file_sysv(file),m,tailleReq,type,attente == ATTENTE_INFINIE ? 0 : IPC_NOWAIT) != -1)
+		return 0;
+	if (attente > 0)
+		usleep(attente < MINPAUSE ? attente : MINPAUSE);
+	return -1;
+}
+
+/**
+ * \fn int depose_reponse_files(int file, int client, Reponse *rep, int bloquant)
+ * \brief Depose une reponse dans une file SysV : elle est adressee par son type (pid du destinataire), le client n'est pas utilise.
+ */
+int depose_reponse_files(int file, int client, Reponse *rep, int bloquant)
+{
+	return msgsnd(file_sysv(file),rep,tailleRep,bloquant ? 0 : IPC_NOWAIT);
+}
+
+/**
+ * \fn void attend_reponse_files(int file, int client, Reponse *rep)
+ * \brief Attend dans une file SysV la reponse typee au pid du processus appelant.
+ */
+void attend_reponse_files(int file, int client, Reponse *rep)
+{
+	msgrcv(file_sysv(file),rep,tailleRep,getpid(),0);
+}
@@ -0,0 +1,81 @@
+#ifndef __TRANSPORT__
+#define __TRANSPORT__
+
+#include "project.h"
+
+/*! La file du serveur. Les files 1 a nb_carrefours sont celles des carrefours. */
+#define FILE_SERVEUR 0
+
+/*! Attente sans limite de recoit_requete(). */
+#define ATTENTE_INFINIE -1
+
+/*! Le nombre de cases d'un anneau de requetes (puissance de 2). */
+#define CAPACITE_ANNEAU 1024
+
+/*! La boite de reponse est vide. */
+#define BOITE_VIDE 0
+/*! La boite de reponse contient une reponse. */
+#define BOITE_PLEINE 1
+/*! La boite de reponse est vide et son client attend (futex). */
+#define BOITE_ATTENTE 2
+
+/**
+ * \struct Transport
+ * \brief Represente un moyen de transport des requetes et des reponses entre voitures, carrefours et serveur.
+ *
+ * Les requetes (et les decisions du serveur, MESSDECISION) sont deposees dans la file d'un destinataire (FILE_SERVEUR ou le numero d'un carrefour), les reponses sont adressees a une voiture (voir client_voiture()).
+ */
+typedef struct Transport {
+	char *nom;	/*!< Le nom du transport (rapport de mesures). */
+	int (*envoie_requete)(int file, Message *m, int bloquant);	/*!< Depose une requete dans une file : 0 si elle a ete deposee, -1 si la file est pleine et bloquant a 0. */
+	int (*recoit_requete)(int file, Message *m, long long attente);	/*!< Retire la requete suivante d'une file, en attendant au plus attente microsecondes (0 : sans attendre, ATTENTE_INFINIE : sans limite) : 0 si une requete a ete lue, -1 sinon. */
+	int (*depose_reponse)(int file, int client, Reponse *rep, int bloquant);	/*!< Depose une reponse pour un client : 0 si elle a ete deposee, -1 si la file est pleine et bloquant a 0. */
+	void (*attend_reponse)(int file, int client, Reponse *rep);	/*!< Attend la reponse destinee a un client. */
+} Transport;
+
+/**
+ * \struct CaseAnneau
+ * \brief Represente une case d'un anneau de requetes : un numero de sequence et une requete.
+ *
+ * La case d'indice i est libre pour la position p (p%CAPACITE_ANNEAU == i) quand sa sequence vaut p, et contient la requete de la position p quand elle vaut p+1.
+ */
+typedef struct CaseAnneau {
+	unsigned long long sequence;	/*!< Le numero de sequence de la case. */
+	Message m;	/*!< La requete. */
+} CaseAnneau;
+
+/**
+ * \struct Anneau
+ * \brief Represente un anneau de requetes en memoire partagee, a plusieurs producteurs et un seul consommateur.
+ */
+typedef struct Anneau {
+	unsigned long long ecriture __attribute__((aligned(TAILLE_LIGNE_CACHE)));	/*!< La prochaine position a reserver par un producteur (compare-and-swap). */
+	unsigned long long lecture __attribute__((aligned(TAILLE_LIGNE_CACHE)));	/*!< La prochaine position a lire par le consommateur. */
+	int attente;	/*!< Vaut 1 quand le consommateur attend sur l'anneau vide (futex). */
+	CaseAnneau cases[CAPACITE_ANNEAU] __attribute__((aligned(TAILLE_LIGNE_CACHE)));	/*!< Les cases de l'anneau. */
+} Anneau;
+
+/**
+ * \struct Boite
+ * \brief Represente la boite de reponse d'un client en memoire partagee (un client attend au plus une reponse a la fois).
+ */
+typedef struct Boite {
+	int etat;	/*!< BOITE_VIDE, BOITE_PLEINE ou BOITE_ATTENTE (futex). */
+	Reponse rep;	/*!< La reponse. */
+} __attribute__((aligned(TAILLE_LIGNE_CACHE))) Boite;
+
+extern Transport transport_files;	/*!< Le transport par files de message SysV (comportement historique). */
+extern Transport transport_anneaux;	/*!< Le transport par anneaux et boites de reponse en memoire partagee. */
+extern Transport *transport;	/*!< Le transport choisi au lancement. */
+
+void initialise_transport(int nbVoitures);
+
+int client_voiture(int numero);
+
+void supprime_transport();
+
+void initialise_anneaux(int nbFiles, int nbClients);
+
+void supprime_anneaux();
+
+#endif
@@ -13,42 +13,55 @@
 #include "project.h"
 #include "voiture.h"
 #include "interface.h"
-
-/*! Represente les 12 voies du carrefour. */
-Voie voies[12] = {	{1,{15,16,17,13,8,3},{11,7,10,4,7,8},{HO,HO,VE,VE,VE,VE}},
-					{2,{20,21,23,24,-1},{11,7,4,5,-1},{HO,HO,HO,HO}},
-					{3,{-1},{-1}},
-					{4,{23,18,13,7,6,5},{2,10,1,7,10,11},{VE,VE,HO,HO,HO,HO}},
-					{5,{24,19,9,4,-1},{2,10,7,8,-1},{VE,VE,VE,VE}},
-					{6,{-1},{-1}},
-					{7,{9,8,7,11,16,21},{5,1,4,10,1,2},{HO,HO,VE,VE,VE,VE}},
-					{8,{4,3,1,0,-1},{5,1,10,11,-1},{HO,HO,HO,HO}},
-					{9,{-1},{-1}},
-					{10,{1,6,11,17,18,19},{8,4,7,1,4,5},{VE,VE,HO,HO,HO,HO}},
-					{11,{0,5,15,20,-1},{8,4,1,2,-1},{VE,VE,VE,VE}},
-					{12,{-1},{-1}}	};
+#include "sem.h"
+#include "carrefour.h"
+#include "trace.h"
+#include "alea.h"
+#include "moteur.h"
+#include "mesure.h"
+#include "statistiques.h"
+#include "topologie.h"
+#include "message.h"
+#include "transport.h"
+
+/*! Represente les passages des 12 voies sur les croisements, voie apres voie dans l'ordre de parcours (voir Voie). */
+Passage passages[40] = {	{15,11,HO},{16,7,HO},{17,10,VE},{13,4,VE},{8,7,VE},{3,8,VE},
+							{20,11,HO},{21,7,HO},{23,4,HO},{24,5,HO},
+							{23,2,VE},{18,10,VE},{13,1,HO},{7,7,HO},{6,10,HO},{5,11,HO},
+							{24,2,VE},{19,10,VE},{9,7,VE},{4,8,VE},
+							{9,5,HO},{8,1,HO},{7,4,VE},{11,10,VE},{16,1,VE},{21,2,VE},
+							{4,5,HO},{3,1,HO},{1,10,HO},{0,11,HO},
+							{1,8,VE},{6,4,VE},{11,7,HO},{17,1,HO},{18,4,HO},{19,5,HO},
+							{0,8,VE},{5,4,VE},{15,1,VE},{20,2,VE}	};
+
+/*! Represente les 12 voies du carrefour (numero, premier passage, nombre de passages). */
+Voie voies[12] = {	{1,0,6}, {2,6,4}, {3,10,0},
+					{4,10,6}, {5,16,4}, {6,20,0},
+					{7,20,6}, {8,26,4}, {9,30,0},
+					{10,30,6}, {11,36,4}, {12,40,0}	};
 
 /*! Represente les voies "d'entree" associees aux voies "de sortie" respectives. */
 int assoc_voies[] = {4,2,12,7,5,3,10,8,6,1,11,9};
 
-/*! Represente les carrefours associes aux voies "de sorties" respectives. */
-int assoc_carrefours[][12] = {	{-1,2,3,-1,-1,2,3,-1,-1,2,3,-1},
-								{-1,-1,4,1,-1,-1,4,1,-1,-1,4,1},
-								{1,4,-1,-1,1,4,-1,-1,1,4,-1,-1},
-								{2,-1,-1,3,2,-1,-1,3,2,-1,-1,3}	};
+/*! Le flux aleatoire de la voiture (un processus par voiture). */
+Alea alea_voiture;
+/*! La date d'arrivee de la voiture sur la carte (un processus par voiture), pour la mesure de la duree de son trajet. */
+long long debut_trajet;
+/*! La date d'emission de la derniere demande de la voiture (un processus par voiture), pour la mesure de son attente. */
+long long date_demande;
 
 /**
- * \fn void initRand()
- * \brief Permet de generer de nouveaux nombres aleatoires.
+ * \fn void initRand(int numero)
+ * \brief Initialise le flux aleatoire de la voiture.
  *
  * Necessaire pour que les differents processus (les voitures) ne generent pas les memes nombres aleatoires (les memes voies, carrefours, temps de pause, etc...).
- * Genere un seed base sur 3 variables pour assurer l'aspect aleatoire.
+ * Le flux est derive de la graine globale et du numero de la voiture : une meme graine redonne les memes parcours et les memes pauses.
+ *
+ * \param numero Le numero de la voiture.
  */
-void initRand()
+void initRand(int numero)
 {
-	struct timeval t;
-	gettimeofday(&t, NULL);
-	srand(t.tv_usec * t.tv_sec * getpid());
+	initialise_alea(&alea_voiture, numero);
 }
 
 /**
@@ -62,12 +75,10 @@ void affiche_voiture(Voiture *v)
 	printf("Numero : %d\n", v->numero);
 	printf("Voie : %d\n", v->voie->numero);
 
-	int i=0;
+	int i;
 	printf("Croisements : {");
-	while (v->voie->sem_num[i] != -1) {
-		printf("%d,", v->voie->sem_num[i]);
-		i++;
-	}
+	for (i=0;i<v->voie->nombre;i++)
+		printf("%d,", passages[v->voie->premier + i].croisement);
 	printf("}\n");
 }
 
@@ -81,12 +92,12 @@ void affiche_carrefours()
 {
 	int i,j;
 
-	for (i=0;i<4;i++) {
+	for (i=1;i<=nb_carrefours;i++) {
 		printf("---------------------------\n");
-		printf("Carrefour %d :\n", i+1);
+		printf("Carrefour %d :\n", i);
 
 		for (j=0;j<12;j++) {
-			printf("Voie %d sort sur carrefour %d voie %d\n", j+1, assoc_carrefours[i][j], assoc_voies[j]);
+			printf("Voie %d sort sur carrefour %d voie %d\n", j+1, carrefour_suivant(i, j+1), assoc_voies[j]);
 		}
 
 		printf("---------------------------\n");
@@ -109,6 +120,8 @@ void affiche_carrefours()
  *   - La voie ou elle arrive sera aleatoire parmis les 3 "possibles dans la realite" selon la direction d'arrivee sur le carrefour (Nord, Ouest, Est, Sud) (<=> simule un changement de voie par le conducteur).
  * - Parcours de la voie par la voiture.
  *
+ * En reservation de parcours, la voiture s'engage sur sa voie en une seule demande (MESSRESERVE) avant de la parcourir, sans autre demande jusqu'a sa sortie.
+ *
  * \param numero Le numero de la voiture.
  * \param voie Le numero de la voie. Peut valoir :
  * - -1 : la voiture prendra une voie dont le numero est genere aleatoirement :
@@ -122,18 +135,22 @@ void voiture(int numero, int voie, int carrefour, int premier_lancement)
 	Voiture v;
 	Requete req;
 	Reponse rep;
-	int croisement_numero, croisement_voie, croisement_orientation, croisement_precedent_numero, croisement_precedent_orientation, i;
+	Passage *p;
+	int croisement_numero, croisement_voie, croisement_orientation, croisement_precedent_numero, croisement_precedent_orientation, suivant, i;
 
 	v.numero = numero;
 
-	initRand();
+	if (premier_lancement == 1) {
+		initRand(numero);
+		debut_trajet = maintenant();
+	}
 
 	if (carrefour == -1) {
-		int carrefour_random = rand()%4+1;
+		int carrefour_random = alea(&alea_voiture)%nb_carrefours+1;
 		v.carrefour = carrefour_random;
 
 		if (voie == -1) {
-			int voie_random = rand()%12+1;
+			int voie_random = alea(&alea_voiture)%12+1;
 			v.voie = &voies[voie_random-1];
 		} else
 			v.voie = &voies[voie-1];
@@ -142,7 +159,7 @@ void voiture(int numero, int voie, int carrefour, int premier_lancement)
 
 		if (premier_lancement == 1) {
 			if (voie == -1) {
-				int voie_random = rand()%12+1;
+				int voie_random = alea(&alea_voiture)%12+1;
 				v.voie = &voies[voie_random-1];
 			} else
 				v.voie = &voies[voie-1];
@@ -154,65 +171,74 @@ void voiture(int numero, int voie, int carrefour, int premier_lancement)
 
 	create_question(&req, &v, v.carrefour, -1, -1, -1, -1, v.voie->numero, -1, MESSARRIVE);
 
-	for (i=0 ; i < 6 ; i++) {
-		croisement_numero = v.voie->sem_num[i];
-
-		if (croisement_numero == -1) break;
+	if (reservation == 1 && v.voie->nombre > 0) {
+		create_question(&req, &v, v.carrefour, -1, -1, -1, -1, v.voie->numero, -1, MESSRESERVE);
+		receive_answer(&req,v.carrefour);
+	}
 
-		croisement_voie = v.voie->croisements[i];
-		croisement_orientation = v.voie->orientation[i];
+	for (i=0 ; i < v.voie->nombre ; i++) {
+		p = &passages[v.voie->premier + i];
+		croisement_numero = p->croisement;
+		croisement_voie = p->voie;
+		croisement_orientation = p->orientation;
 		if (i == 0) {
 			croisement_precedent_numero = -1;
 			croisement_precedent_orientation = -1;
 		} else {
-			croisement_precedent_numero = v.voie->sem_num[i-1];
-			croisement_precedent_orientation = v.voie->orientation[i-1];
+			croisement_precedent_numero = (p-1)->croisement;
+			croisement_precedent_orientation = (p-1)->orientation;
 		}
 
-		create_question(&req, &v, v.carrefour, croisement_precedent_numero, croisement_precedent_orientation, croisement_numero, croisement_orientation, croisement_voie, AVANT, MESSDEMANDE);
-		receive_answer(&req,v.carrefour);
+		if (reservation == 0) {
+			create_question(&req, &v, v.carrefour, croisement_precedent_numero, croisement_precedent_orientation, croisement_numero, croisement_orientation, croisement_voie, AVANT, MESSDEMANDE);
+			receive_answer(&req,v.carrefour);
+		}
 
 		create_question(&req, &v, v.carrefour, croisement_precedent_numero, croisement_precedent_orientation, croisement_numero, croisement_orientation, croisement_voie, AVANT, MESSINFO);
 
-		usleep(rand()%MAXPAUSE+MINPAUSE);
+		usleep(alea(&alea_voiture)%MAXPAUSE+MINPAUSE);
 
-		create_question(&req, &v, v.carrefour, croisement_precedent_numero, croisement_precedent_orientation, croisement_numero, croisement_orientation, croisement_voie, PENDANT, MESSDEMANDE);
-		receive_answer(&req,v.carrefour);
+		if (reservation == 0) {
+			create_question(&req, &v, v.carrefour, croisement_precedent_numero, croisement_precedent_orientation, croisement_numero, croisement_orientation, croisement_voie, PENDANT, MESSDEMANDE);
+			receive_answer(&req,v.carrefour);
+		}
 
 		create_question(&req, &v, v.carrefour, croisement_precedent_numero, croisement_precedent_orientation, croisement_numero, croisement_orientation, croisement_voie, PENDANT, MESSINFO);
 
-		usleep(rand()%MAXPAUSE+MINPAUSE);
+		usleep(alea(&alea_voiture)%MAXPAUSE+MINPAUSE);
 
-		create_question(&req, &v, v.carrefour, croisement_precedent_numero, croisement_precedent_orientation, croisement_numero, croisement_orientation, croisement_voie, APRES, MESSDEMANDE);
-		receive_answer(&req,v.carrefour);
+		if (reservation == 0) {
+			create_question(&req, &v, v.carrefour, croisement_precedent_numero, croisement_precedent_orientation, croisement_numero, croisement_orientation, croisement_voie, APRES, MESSDEMANDE);
+			receive_answer(&req,v.carrefour);
+		}
 
 		create_question(&req, &v, v.carrefour, croisement_precedent_numero, croisement_precedent_orientation, croisement_numero, croisement_orientation, croisement_voie, APRES, MESSINFO);
 
-		usleep(rand()%MAXPAUSE+MINPAUSE);
+		usleep(alea(&alea_voiture)%MAXPAUSE+MINPAUSE);
 	}
 
-	croisement_precedent_numero = v.voie->sem_num[i-1];
-	croisement_precedent_orientation = v.voie->orientation[i-1];
-
 	if (i == 0) {
 		create_question(&req, &v, v.carrefour, -1, -1, -1, -1, v.voie->numero, -1, MESSSORT);
 	} else {
-		create_question(&req, &v, v.carrefour, croisement_precedent_numero, croisement_precedent_orientation, -1, -1, v.voie->numero, -1, MESSSORT);
+		p = &passages[v.voie->premier + i - 1];
+		create_question(&req, &v, v.carrefour, p->croisement, p->orientation, -1, -1, v.voie->numero, -1, MESSSORT);
 	}
 
-	if (assoc_carrefours[v.carrefour-1][v.voie->numero-1] == -1) {
+	suivant = carrefour_suivant(v.carrefour, v.voie->numero);
+	if (suivant == -1) {
 		P(MUTEX);
 		int *c = shmat(compteur, NULL, 0);
 		(*c)++;
 		sprintf(buffer, "%d Voitures sont sorties\n", *c);
-		message(0, buffer);
+		bilan(buffer);
 		V(MUTEX);
+		mesure_trajet(maintenant() - debut_trajet);
 		exit(0);
 	}
 
-	usleep(rand()%MAXPAUSE+MINPAUSE);
+	usleep(alea(&alea_voiture)%MAXPAUSE+MINPAUSE);
 
-	voiture(v.numero, assoc_voies[v.voie->numero-1], assoc_carrefours[v.carrefour-1][v.voie->numero-1], 0);
+	voiture(v.numero, assoc_voies[v.voie->numero-1], suivant, 0);
 }
 
 /**
@@ -224,6 +250,10 @@ void voiture(int numero, int voie, int carrefour, int premier_lancement)
  * - MESSDEMANDE : demande d'arrivee en zone avant, pendant, ou apres un croisement. Implique une demande au serveur (depuis le carrefour) qui va analyser le carrefour pour prendre une decision.
  * - MESSINFO : message d'information d'arrivee avant, pendant, ou apres un croisement. N'implique aucun traitement, affiche juste l'information.
  * - MESSSORT : message d'information de sortie d'un carrefour. Implique de mettre a jour la file d'attente "apres" le croisement precedent.
+ * - MESSRESERVE : demande d'engagement sur la voie (reservation de parcours).
+ *
+ * En ADMISSION_ATOMIQUE, les MESSDEMANDE ne sont pas envoyees (la reservation est faite par receive_answer()) et les MESSSORT sont appliques directement au carrefour.
+ * En reservation de parcours, les MESSINFO ne sont pas envoyes : le carrefour n'a rien a mettre a jour avant la sortie de la voiture.
  *
  * \param req Pointeur vers la requete qui va etre renseignee.
  * \param v Pointeur vers la voiture effectuant la requete.
@@ -245,14 +275,34 @@ void voiture(int numero, int voie, int carrefour, int premier_lancement)
  * - MESSDEMANDE.
  * - MESSINFO.
  * - MESSSORT.
+ * - MESSRESERVE.
  */
 void create_question(Requete *req, Voiture *v, int carrefour, int croisement_precedent, int croisement_precedent_orientation, int croisement, int croisement_orientation, int voie, int traverse, int type)
 {
-	P(MUTEX);
+	Message m;
+
 	constructionRequete(req, v, carrefour, croisement_precedent, croisement_precedent_orientation, croisement, croisement_orientation, voie, traverse, type);
 	affichageRequete(req);
-	msgsnd(msg_carrefour[carrefour-1],req,tailleReq,0);
-	V(MUTEX);
+	trace_requete(req, -1);
+	compte_requete();
+	if (type == MESSDEMANDE || type == MESSRESERVE)
+		date_demande = maintenant();
+
+	if (reservation == 1 && type == MESSINFO)
+		return;
+
+	if (admission == ADMISSION_ATOMIQUE) {
+		if (type == MESSDEMANDE || type == MESSRESERVE)
+			return;
+		if (type == MESSSORT) {
+			reserve_croisement(req, &reseau[carrefour-1]);
+			return;
+		}
+	}
+
+	encode_requete(req, &m);
+	transport->envoie_requete(carrefour, &m, 1);
+	compte_message();
 }
 
 /**
@@ -261,7 +311,9 @@ void create_question(Requete *req, Voiture *v, int carrefour, int croisement_pre
  *
  * Ne retourne que lorsque la reponse du serveur aura ete positive.
  * Permet de bloquer la voiture tant qu'elle n'a pas eu la permission d'avancer.
- * Tant qu'elle est bloquee, la voiture renvoie des demandes au serveur (via le carrefour) a intervalles reguliers.
+ * Tant qu'elle est bloquee, la voiture n'emet aucun message : le carrefour garde sa demande en attente et ne lui repond qu'une fois le croisement libere (voir reveille_attentes()).
+ * En ADMISSION_ATOMIQUE, la voiture reserve elle meme sa place dans le segment du carrefour (reserve_croisement()) et reessaie apres MINPAUSE en cas de refus, toujours sans message.
+ * En ordre par tickets, elle prend un ticket avant son premier essai (prend_ticket()) : ses essais echouent tant qu'une voiture arrivee avant elle attend la meme case.
  *
  * \param req Pointeur vers la requete qui a ete envoyee.
  * \param carrefour Le numero du carrefour ou se trouve la voiture. Utile pour n'ecouter que la file de message du carrefour concerne.
@@ -269,21 +321,23 @@ void create_question(Requete *req, Voiture *v, int carrefour, int croisement_pre
 void receive_answer(Requete *req, int carrefour)
 {
 	Reponse rep;
-	msgrcv(msg_carrefour[carrefour-1],&rep,tailleRep,getpid(),0);
-	P(MUTEX);
-	affichageReponse(req,&rep);
-	V(MUTEX);
-	if (rep.autorisation == 0) {
-		do {
-			msgsnd(msg_carrefour[carrefour-1],req,tailleReq,0);
-			msgrcv(msg_carrefour[carrefour-1],&rep,tailleRep,getpid(),0);
-			usleep(MINPAUSE);
-		} while (rep.autorisation == 0);
-		P(MUTEX);
-		affichageRequete(req);
-		affichageReponse(req,&rep);
-		V(MUTEX);
+
+	if (admission == ADMISSION_ATOMIQUE) {
+		if (ordre == ORDRE_TICKETS && req->type == MESSDEMANDE)
+			req->ticket = prend_ticket(&reseau[carrefour-1], req);
+		if (reserve_croisement(req, &reseau[carrefour-1]) == 0) {
+			stats_refus(req);
+			while (reserve_croisement(req, &reseau[carrefour-1]) == 0)
+				usleep(MINPAUSE);
+		}
+		rep.autorisation = 1;
+	} else {
+		transport->attend_reponse(carrefour, client_voiture(req->voiture), &rep);
 	}
+
+	affichageReponse(req,&rep);
+	trace_requete(req, rep.autorisation);
+	stats_accord(req, maintenant() - date_demande);
 }
 
 /**
@@ -305,10 +359,186 @@ void receive_answer(Requete *req, int carrefour)
 int random_voie(int v)
 {
 	if (v == 1 || v == 2 || v == 3)
-	return rand()%3+1;
+	return alea(&alea_voiture)%3+1;
 	if (v == 4 || v == 5 || v == 6)
-	return rand()%3+4;
+	return alea(&alea_voiture)%3+4;
 	if (v == 7 || v == 8 || v == 9)
-	return rand()%3+7;
-	return rand()%3+10;
+	return alea(&alea_voiture)%3+7;
+	return alea(&alea_voiture)%3+10;
+}
+
+/**
+ * \fn int random_voie_r(int v, Alea *a)
+ * \brief Equivalent de random_voie() utilisant le flux aleatoire passe en parametre.
+ *
+ * Utilise par les moteurs ou plusieurs voitures partagent le meme processus.
+ *
+ * \param v Numero de la voie d'arrivee.
+ * \param a Pointeur sur le flux aleatoire de la voiture.
+ *
+ * \return Le numero de voie aleatoire parmis les voies possibles.
+ */
+int random_voie_r(int v, Alea *a)
+{
+	return ((v-1)/3)*3 + alea(a)%3+1;
+}
+
+/**
+ * \fn void initialise_etat(EtatVoiture *e, int numero, int voie, int carrefour)
+ * \brief Initialise l'etat d'une voiture au lancement du programme.
+ *
+ * Equivalent de la phase d'initialisation de voiture() lors du premier lancement (meme flux aleatoire, memes tirages).
+ *
+ * \param e Pointeur sur l'etat a initialiser.
+ * \param numero Le numero de la voiture.
+ * \param voie Le numero de la voie (-1 pour une voie aleatoire).
+ * \param carrefour Le numero du carrefour (-1 pour un carrefour aleatoire).
+ */
+void initialise_etat(EtatVoiture *e, int numero, int voie, int carrefour)
+{
+	initialise_alea(&e->alea, numero);
+	e->v.numero = numero;
+
+	if (carrefour == -1)
+		e->v.carrefour = alea(&e->alea)%nb_carrefours+1;
+	else
+		e->v.carrefour = carrefour;
+
+	if (voie == -1)
+		e->v.voie = &voies[alea(&e->alea)%12];
+	else
+		e->v.voie = &voies[voie-1];
+
+	e->arrivee = 0;
+	e->demande = -1;
+	e->ticket = -1;
+	e->indice = 0;
+	e->etape = ENTREE;
+}
+
+/**
+ * \fn int etape_voiture(EtatVoiture *e, int (*demande)(Requete *req), long long date)
+ * \brief Fait avancer une voiture d'une etape sur son parcours.
+ *
+ * Reprend pas a pas le parcours de voiture() (arrivee, AVANT / PENDANT / APRES pour chaque croisement de la voie, sortie, changement de carrefour) sans bloquer ni dormir : les pauses sont retournees a l'appelant qui se charge de reprogrammer la voiture.
+ * Les arrivees, sorties et reponses aux demandes sont enregistrees dans la trace binaire si elle est activee, les attentes des demandes dans les statistiques des croisements.
+ * En reservation de parcours, seule l'etape AVANT du premier croisement emet une demande (MESSRESERVE) : les etapes suivantes avancent sans demande jusqu'a la sortie.
+ * En ordre par tickets, une demande prend un ticket a sa premiere emission et le presente a chaque nouvel essai, jusqu'a son autorisation.
+ *
+ * \param e Pointeur sur l'etat de la voiture.
+ * \param demande Fonction qui traite la requete de la voiture. Pour une MESSDEMANDE ou une MESSRESERVE, elle decide et met a jour le carrefour de maniere atomique et retourne l'autorisation. Pour un MESSSORT, elle met a jour le carrefour.
+ * \param date La date courante (reelle ou virtuelle selon le moteur, en microseconde).
+ *
+ * \return La duree (en microseconde) avant la prochaine etape de la voiture, ou FIN si la voiture a quitte la carte.
+ */
+int etape_voiture(EtatVoiture *e, int (*demande)(Requete *req), long long date)
+{
+	Requete req;
+	Voie *voie = e->v.voie;
+	Passage *p = &passages[voie->premier + e->indice];
+	int croisement_precedent_numero = -1, croisement_precedent_orientation = -1, suivant, autorisation, pause;
+
+	if (e->indice > 0) {
+		croisement_precedent_numero = (p-1)->croisement;
+		croisement_precedent_orientation = (p-1)->orientation;
+	}
+
+	if (e->etape == ENTREE) {
+		constructionRequete(&req, &e->v, e->v.carrefour, -1, -1, -1, -1, voie->numero, -1, MESSARRIVE);
+		trace_requete(&req, -1);
+		compte_requete();
+		e->indice = 0;
+		e->etape = (voie->nombre == 0) ? SORTIE : AVANT;
+		return 0;
+	}
+
+	if (e->etape == SORTIE) {
+		constructionRequete(&req, &e->v, e->v.carrefour, croisement_precedent_numero, croisement_precedent_orientation, -1, -1, voie->numero, -1, MESSSORT);
+		(*demande)(&req);
+		trace_requete(&req, -1);
+		compte_requete();
+
+		suivant = carrefour_suivant(e->v.carrefour, voie->numero);
+		if (suivant == -1)
+			return FIN;
+
+		pause = alea(&e->alea)%MAXPAUSE+MINPAUSE;
+		e->v.voie = &voies[random_voie_r(assoc_voies[voie->numero-1], &e->alea)-1];
+		e->v.carrefour = suivant;
+		e->indice = 0;
+		e->etape = ENTREE;
+		return pause;
+	}
+
+	if (reservation == 0 || (e->indice == 0 && e->etape == AVANT)) {
+		if (reservation == 0)
+			constructionRequete(&req, &e->v, e->v.carrefour, croisement_precedent_numero, croisement_precedent_orientation, p->croisement, p->orientation, p->voie, e->etape, MESSDEMANDE);
+		else
+			constructionRequete(&req, &e->v, e->v.carrefour, -1, -1, -1, -1, voie->numero, -1, MESSRESERVE);
+		if (ordre == ORDRE_TICKETS && reservation == 0) {
+			if (e->ticket == -1)
+				e->ticket = prend_ticket(&reseau[e->v.carrefour-1], &req);
+			req.ticket = e->ticket;
+		}
+		autorisation = (*demande)(&req);
+		trace_requete(&req, autorisation);
+		compte_requete();
+		if (autorisation == 0) {
+			if (e->demande == -1) {
+				e->demande = date;
+				stats_refus(&req);
+			}
+			return MINPAUSE;
+		}
+
+		stats_accord(&req, e->demande == -1 ? 0 : date - e->demande);
+		e->demande = -1;
+		e->ticket = -1;
+	}
+
+	if (e->etape == APRES) {
+		e->indice++;
+		e->etape = (e->indice == voie->nombre) ? SORTIE : AVANT;
+	} else {
+		e->etape++;
+	}
+
+	return alea(&e->alea)%MAXPAUSE+MINPAUSE;
+}
+
+/**
+ * \fn int progression_voiture(EtatVoiture *e)
+ * \brief Indique si la prochaine etape d'une voiture est une progression sans demande, pour la detection des interblocages (voir DUREE_INTERBLOCAGE).
+ *
+ * Une arrivee sur un carrefour est une progression : des arrivees espacees ne sont pas un interblocage. De meme pour les etapes sans demande qui suivent une reservation de parcours.
+ *
+ * \param e Pointeur sur la voiture.
+ *
+ * \return 1 si l'etape est une progression, 0 si elle attend une autorisation.
+ */
+int progression_voiture(EtatVoiture *e)
+{
+	return e->etape == ENTREE || (reservation == 1 && (e->etape != AVANT || e->indice > 0));
+}
+
+/**
+ * \fn unsigned int masque_parcours(int voie)
+ * \brief Retourne l'ensemble des croisements d'une voie, sous forme de masque (bit i : croisement i).
+ *
+ * Utilise par la reservation de parcours (deux voies se croisent si leurs masques ont un bit commun, voir initialise_parcours()) et par les feux.
+ *
+ * \param voie Le numero de la voie (1<=voie<=12).
+ *
+ * \return Le masque des croisements de la voie (0 si elle ne croise aucune autre voie).
+ */
+unsigned int masque_parcours(int voie)
+{
+	Voie *v = &voies[voie-1];
+	unsigned int masque = 0;
+	int i;
+
+	for (i=0;i<v->nombre;i++)
+		masque |= 1U << passages[v->premier + i].croisement;
+
+	return masque;
 }
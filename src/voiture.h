@@ -3,11 +3,14 @@
 
 #include "project.h"
 
+extern Passage passages[40];	/*!< Les passages des 12 voies sur les croisements, voie apres voie dans l'ordre de parcours. */
+extern Voie voies[12];	/*!< Les 12 voies d'un carrefour. */
+
 void affiche_voiture(Voiture *v);
 
 void affiche_carrefours();
 
-void initRand();
+void initRand(int numero);
 
 void voiture(int numero, int voie, int carrefour, int premier_lancement);
 
@@ -19,4 +22,14 @@ void receive_answer(Requete *req, int carrefour);
 
 int random_voie(int voie);
 
+int random_voie_r(int v, Alea *a);
+
+void initialise_etat(EtatVoiture *e, int numero, int voie, int carrefour);
+
+int etape_voiture(EtatVoiture *e, int (*demande)(Requete *req), long long date);
+
+int progression_voiture(EtatVoiture *e);
+
+unsigned int masque_parcours(int voie);
+
 #endif